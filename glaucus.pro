@@ -4,11 +4,22 @@
 
 TEMPLATE = app
 TARGET = glaucus
-CONFIG   += console c++11
+CONFIG   += console c++11 thread
 CONFIG   -= app_bundle
 DEPENDPATH += . src
 INCLUDEPATH += .
 
+# the consistency checks of make_move and unmake_move are asserts, they
+# run in debug builds only: qmake CONFIG+=debug
+CONFIG(release, debug|release) {
+    DEFINES += NDEBUG
+}
+
+# profiling build recording every search node: qmake CONFIG+=record
+record {
+    DEFINES += TREE_RECORD
+}
+
 # Input
 SOURCES += src/main.cpp \
     src/commands.cpp \
@@ -16,7 +27,22 @@ SOURCES += src/main.cpp \
     src/utils.cpp \
     src/attacks.cpp \
     src/bitscan.cpp \
-    src/movegen.cpp
+    src/movegen.cpp \
+    src/mailbox.cpp \
+    src/verify.cpp \
+    src/transtable.cpp \
+    src/largemem.cpp \
+    src/eval.cpp \
+    src/search.cpp \
+    src/moveorder.cpp \
+    src/see.cpp \
+    src/mate.cpp \
+    src/input.cpp \
+    src/timeman.cpp \
+    src/stats.cpp \
+    src/recorder.cpp \
+    src/nnue.cpp \
+    src/tuner.cpp
 
 OTHER_FILES += \
     schedule.txt
@@ -27,4 +53,19 @@ HEADERS += \
     src/utils.h \
     src/attacks.h \
     src/bitscan.h \
-    src/movegen.h
+    src/movegen.h \
+    src/mailbox.h \
+    src/verify.h \
+    src/transtable.h \
+    src/largemem.h \
+    src/eval.h \
+    src/search.h \
+    src/moveorder.h \
+    src/see.h \
+    src/mate.h \
+    src/input.h \
+    src/timeman.h \
+    src/stats.h \
+    src/recorder.h \
+    src/nnue.h \
+    src/tuner.h
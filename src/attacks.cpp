@@ -41,7 +41,7 @@ const bits128 Attacks::king_attacks[HEXES_NUMBER_MAX] = {
 	{17211331584ULL,0ULL},
 	{34422663168ULL,0ULL},
 	{68845326336ULL,0ULL},
-	{137556516864ULL,0ULL},
+	{137556500480ULL,0ULL},
 	{234962944ULL,0ULL},
 	{137908895744ULL,0ULL},
 	{275884867584ULL,0ULL},
@@ -52,7 +52,7 @@ const bits128 Attacks::king_attacks[HEXES_NUMBER_MAX] = {
 	{35248807091200ULL,0ULL},
 	{70497614183424ULL,0ULL},
 	{140995228366848ULL,0ULL},
-	{281715746598912ULL,0ULL},
+	{281715713044480ULL,0ULL},
 	{481204363264ULL,0ULL},
 	{282437418975232ULL,0ULL},
 	{565012209795072ULL,0ULL},
@@ -63,7 +63,7 @@ const bits128 Attacks::king_attacks[HEXES_NUMBER_MAX] = {
 	{72189556922778624ULL,0ULL},
 	{144379113847654400ULL,0ULL},
 	{288758227695308800ULL,0ULL},
-	{576953849034579968ULL,0ULL},
+	{576953780315103232ULL,0ULL},
 	{985506536046592ULL,0ULL},
 	{578431834061406208ULL,0ULL},
 	{1157145005660569600ULL,0ULL},
@@ -74,7 +74,7 @@ const bits128 Attacks::king_attacks[HEXES_NUMBER_MAX] = {
 	{270259988174209024ULL,8ULL},
 	{540519980643385344ULL,16ULL},
 	{1081039961286770688ULL,32ULL},
-	{1009862105408471040ULL,64ULL},
+	{1009721367920115712ULL,64ULL},
 	{2018317385823420416ULL,0ULL},
 	{4036775440348610560ULL,64ULL},
 	{8649730158023933952ULL,128ULL},
@@ -85,7 +85,7 @@ const bits128 Attacks::king_attacks[HEXES_NUMBER_MAX] = {
 	{90133569493532672ULL,16414ULL},
 	{180275935080087552ULL,32828ULL},
 	{360551870160175104ULL,65656ULL},
-	{2162255621078908928ULL,131184ULL},
+	{1874025244927197184ULL,131184ULL},
 	{1443333655425449984ULL,224ULL},
 	{3174756812075302912ULL,131520ULL},
 	{5773052871847182336ULL,263104ULL},
@@ -96,7 +96,7 @@ const bits128 Attacks::king_attacks[HEXES_NUMBER_MAX] = {
 	{126109585659396096ULL,33611786ULL},
 	{270233569828274176ULL,67231764ULL},
 	{540467139656548352ULL,134463528ULL},
-	{1080934279313096704ULL,268665072ULL},
+	{1080934279313096704ULL,268665040ULL},
 	{4468274517793308672ULL,458912ULL},
 	{8648037184458194944ULL,269353312ULL},
 	{17296074368916389888ULL,538837632ULL},
@@ -107,7 +107,7 @@ const bits128 Attacks::king_attacks[HEXES_NUMBER_MAX] = {
 	{18014398509481984ULL,100679694ULL},
 	{36028797018963968ULL,137673875486ULL},
 	{72057594037927936ULL,275381305404ULL},
-	{144115188075855872ULL,550226067576ULL},
+	{144115188075855872ULL,550226002040ULL},
 	{1441151880758558720ULL,939852272ULL},
 	{2305843009213693952ULL,551635583936ULL},
 	{4611686018427387904ULL,1103539472256ULL},
@@ -118,7 +118,7 @@ const bits128 Attacks::king_attacks[HEXES_NUMBER_MAX] = {
 	{0ULL,0ULL},
 	{0ULL,412384026628ULL},
 	{0ULL,563912193990664ULL},
-	{0ULL,1126862986395664ULL},
+	{0ULL,1126862852177936ULL},
 	{0ULL,1924817453216ULL},
 	{0ULL,1129749675901184ULL},
 	{0ULL,2255650792669696ULL},
@@ -129,7 +129,7 @@ const bits128 Attacks::king_attacks[HEXES_NUMBER_MAX] = {
 	{0ULL,0ULL},
 	{0ULL,0ULL},
 	{0ULL,1689124973068288ULL},
-	{0ULL,2307533921161609216ULL},
+	{0ULL,2307533646283702272ULL},
 	{0ULL,3942026144186368ULL},
 	{0ULL,2309223736618254336ULL},
 	{0ULL,3378802991300608ULL},
@@ -140,7 +140,7 @@ const bits128 Attacks::king_attacks[HEXES_NUMBER_MAX] = {
 	{0ULL,0ULL},
 	{0ULL,0ULL},
 	{0ULL,0ULL},
-	{0ULL,2309784621027426304ULL},
+	{0ULL,2309221671074004992ULL},
 	{0ULL,2308662020259446784ULL},
 	{0ULL,2307535708438396928ULL},
 	{0ULL,0ULL},
@@ -283,8 +283,9 @@ const bits128 Attacks::knight_attacks[HEXES_NUMBER_MAX] = {
 	{0ULL,1811939328ULL}
 };
 
-bits128 Attacks::opponent_attacks;
-bits128 Attacks::own_attacks;
+thread_local bits128 Attacks::opponent_attacks;
+thread_local bits128 Attacks::own_attacks;
+thread_local attack_maps Attacks::maps;
 
 
 Attacks::Attacks()
@@ -300,35 +301,56 @@ void Attacks::init()
 void Attacks::generate_moves()
 {
 	bitmaps temp = Hexbitboard::get_bitboards();
-	MoveGen::reset_move_stack();
+	if (MoveGen::white_to_move) {
+		generate(~temp.white_pieces & ~temp.black_king);
+	}
+	else {
+		generate(~temp.black_pieces & ~temp.white_king);
+	}
+}
+
+void Attacks::generate_captures()
+{
+	bitmaps temp = Hexbitboard::get_bitboards();
+	if (MoveGen::white_to_move) {
+		generate(temp.black_pieces & ~temp.black_king);
+	}
+	else {
+		generate(temp.white_pieces & ~temp.white_king);
+	}
+}
+
+/**
+ * fills the current move list with pseudo legal moves to target hexes
+ */
+void Attacks::generate(const bits128 target)
+{
+	bitmaps temp = Hexbitboard::get_bitboards();
+	MoveGen::clear_ply();
 	uint8_t pos_from, pos_to;
-	bits128 own_king, own_knight, own_pieces, opposite_king;
+	bits128 own_king, own_knight;
 	color_to_move side_to_move;
 	if (MoveGen::white_to_move) {
 		own_king = temp.white_king;
 		own_knight = temp.white_knight;
-		own_pieces = temp.white_pieces;
-		opposite_king = temp.black_king;
 		side_to_move = WHITE;
 	}
 	else {
 		own_king = temp.black_king;
 		own_knight = temp.black_knight;
-		own_pieces = temp.black_pieces;
-		opposite_king = temp.white_king;
 		side_to_move = BLACK;
 	}
 
 	// king attacks
 	pos_from = Hexbitboard::get_lsb(own_king);
-	bits128 temp_attacks = king_attacks[pos_from] & ~(own_pieces) &~(opposite_king);
+	bits128 temp_attacks = king_attacks[pos_from] & target;
 	while ((pos_to = Hexbitboard::get_lsb_and_reset(temp_attacks))) {
 		MoveGen::add_move(side_to_move, KING, pos_from, pos_to);
 	}
 
 	// knights attacks
 	while ((pos_from = Hexbitboard::get_lsb_and_reset(own_knight))) {
-		temp_attacks = knight_attacks[pos_from] & ~(own_pieces) & ~(opposite_king);
+		temp_attacks = knight_attacks[pos_from] & target;
 		while ((pos_to = Hexbitboard::get_lsb_and_reset(temp_attacks))) {
 			MoveGen::add_move(side_to_move, KNIGHT, pos_from, pos_to);
 		}
@@ -405,6 +427,33 @@ void Attacks::generate_own_attacks()
 	}
 }
 
+void Attacks::fill_counts(attack_counts &counts, bits128 king, bits128 knights)
+{
+	uint8_t pos_from = Hexbitboard::get_lsb(king);
+	counts.once = king_attacks[pos_from];
+	counts.twice = bits128();
+	counts.thrice = bits128();
+	while ((pos_from = Hexbitboard::get_lsb_and_reset(knights))) {
+		add_attacks(counts, knight_attacks[pos_from]);
+	}
+}
+
+/**
+ * how often each hex is attacked by the men of the colour, both colours
+ * are counted once per position and shared by evaluation and SEE
+ */
+const attack_counts &Attacks::count_attacks(const bool white)
+{
+	const uint64_t key = Hexbitboard::get_key();
+	if (maps.key != key) {
+		bitmaps temp = Hexbitboard::get_bitboards();
+		fill_counts(maps.white, temp.white_king, temp.white_knight);
+		fill_counts(maps.black, temp.black_king, temp.black_knight);
+		maps.key = key;
+	}
+	return white ? maps.white : maps.black;
+}
+
 bool Attacks::position_is_ok()
 {
 	if (!Hexbitboard::get_black_king()) {
@@ -436,3 +485,20 @@ bool Attacks::king_is_attacked()
 		return (opponent_attacks & Hexbitboard::get_black_king());
 	}
 }
+
+/**
+ * cheap check detection, looks only at attackers of the king hex of the
+ * side to move
+ */
+bool Attacks::in_check()
+{
+	bitmaps temp = Hexbitboard::get_bitboards();
+	if (MoveGen::white_to_move) {
+		uint8_t king = Hexbitboard::get_lsb(temp.white_king);
+		return (knight_attacks[king] & temp.black_knight) || (king_attacks[king] & temp.black_king);
+	}
+	else {
+		uint8_t king = Hexbitboard::get_lsb(temp.black_king);
+		return (knight_attacks[king] & temp.white_knight) || (king_attacks[king] & temp.white_king);
+	}
+}
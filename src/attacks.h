@@ -27,7 +27,19 @@
 
 #include "hexbitboard.h"
 
-const uint32_t HEXES_NUMBER_MAX = 126;
+// bit-sliced attack counter: a hex is set in twice only if it is set in once
+struct attack_counts {
+	bits128 once;
+	bits128 twice;
+	bits128 thrice;  // three or more
+};
+
+// the counters of both sides for the position with the key
+struct attack_maps {
+	uint64_t key;
+	attack_counts white;
+	attack_counts black;
+};
 
 class Attacks
 {
@@ -36,16 +48,33 @@ public:
 	static const bits128 knight_attacks[HEXES_NUMBER_MAX];
 	static void init();
 	static void generate_moves();
+	static void generate_captures();
 	static void generate_opponent_attacks();
 	static void generate_own_attacks();
 	static bool position_is_ok();
 	static bool king_is_attacked();
+	static bool in_check();
 	static bits128 enemy_attacks() { return opponent_attacks; }
 	static bits128 my_attacks() { return own_attacks; }
+	static const attack_counts &count_attacks(const bool white);
+	static void add_attacks(attack_counts &counts, const bits128 attacks)
+	{
+		counts.thrice |= counts.twice & attacks;
+		counts.twice |= counts.once & attacks;
+		counts.once |= attacks;
+	}
+	// hexes the attacker hits more often than the defender covers them
+	static bits128 outnumbered(const attack_counts &attacker, const attack_counts &defender)
+	{
+		return (attacker.once & ~defender.once) | (attacker.twice & ~defender.twice) | (attacker.thrice & ~defender.thrice);
+	}
 private:
 	Attacks();
-	static bits128 opponent_attacks;
-	static bits128 own_attacks;
+	static void generate(const bits128 target);
+	static thread_local bits128 opponent_attacks;
+	static thread_local bits128 own_attacks;
+	static thread_local attack_maps maps;
+	static void fill_counts(attack_counts &counts, bits128 king, bits128 knights);
 };
 
 #endif // ATTACKS_H
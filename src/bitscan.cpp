@@ -30,3 +30,16 @@ uint8_t Bitscan::get_lsb(uint64_t bb)
 	//assert(index64[((bb & -bb) * debruijn64) >> 58] > 9);
 	return index64[((bb & -bb) * debruijn64) >> 58];
 }
+
+/**
+ * SWAR population count
+ * @param bb bitboard to count
+ * @return number of one bits
+ */
+uint8_t Bitscan::popcount(uint64_t bb)
+{
+	bb = bb - ((bb >> 1) & 0x5555555555555555ULL);
+	bb = (bb & 0x3333333333333333ULL) + ((bb >> 2) & 0x3333333333333333ULL);
+	bb = (bb + (bb >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+	return uint8_t((bb * 0x0101010101010101ULL) >> 56);
+}
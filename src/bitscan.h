@@ -7,6 +7,7 @@ class Bitscan
 {
 public:
 	static uint8_t get_lsb(uint64_t);
+	static uint8_t popcount(uint64_t);
 private:
 	Bitscan();
 	static const uint8_t index64[64];
@@ -23,6 +23,7 @@
 */
 
 #include <cstdlib>
+#include <chrono>
 #include <sstream>
 #include <iomanip>
 #include "commands.h"
@@ -30,6 +31,15 @@
 #include "attacks.h"
 #include "movegen.h"
 #include "utils.h"
+#include "verify.h"
+#include "transtable.h"
+#include "largemem.h"
+#include "eval.h"
+#include "search.h"
+#include "mate.h"
+#include "stats.h"
+#include "nnue.h"
+#include "tuner.h"
 
 using std::cin;
 using std::cout;
@@ -105,10 +115,35 @@ const command Commands::command_list[] = {
 	{"black"     , command_black     , "black side to move"                     },
 	{"moves"     , command_moves     , "list of pseudo legal moves"             },
 	{"attacks"   , command_attacks   , "display board and attacked fields"      },
+	{"perft"     , command_perft     , "counts leaf nodes of a given depth"     },
+	{"verify"    , command_verify    , "checks movegen against reference, args: games plies depth"},
+	{"hash"      , command_hash      , "sets transposition table size in MB"    },
+	{"clearhash" , command_clearhash , "clears transposition table"             },
+	{"hashfull"  , command_hashfull  , "displays transposition table usage"     },
+	{"numa"      , command_numa      , "hash placement: off, interleave, bind <node>"},
+	{"savehash"  , command_savehash  , "saves hash to a file, args: file [min depth]"},
+	{"loadhash"  , command_loadhash  , "loads hash from a file"                 },
+	{"eval"      , command_eval      , "displays static evaluation"             },
+	{"go"        , command_go        , "searches, args: [depth N] [time ms] [nodes N] [clock ms] [inc ms] [movestogo N]"},
+	{"play"      , command_play      , "plays a move on the board, e.g. play Kg1e1"},
+	{"mate"      , command_mate      , "proof-number mate solver, args: moves [MB]"},
+	{"stop"      , command_stop      , "stops the search or pondering"          },
+	{"slack"     , command_slack     , "displays or sets ms a search may overrun its time"},
+	{"option"    , command_option    , "lists or sets search options, args: [name on|off]"},
+	{"threads"   , command_threads   , "displays or sets number of search threads"},
+	{"multipv"   , command_multipv   , "displays or sets number of lines searched"},
+	{"stats"     , command_stats     , "statistics of the last search, args: [json [file]]"},
+	{"nnue"      , command_nnue      , "network evaluation, args: [load file | on | off | kernel name]"},
+	{"scaling"   , command_scaling   , "time to depth for 1 to 16 threads, args: [depth]"},
+	{"tune"      , command_tune      , "fits eval weights, args: file [epochs N] [rate R] [threads N]"},
 	{""          , command_init      , "dummy"                                  }
 };
 
 bool Commands::rotate = false;
+move_t Commands::expected_move;
+move_t Commands::engine_move;
+uint64_t Commands::engine_key = 0;
+bool Commands::ponder_hit = false;
 
 Commands::Commands()
 {
@@ -116,10 +151,16 @@ Commands::Commands()
 
 void Commands::command_init()
 {
+	Eval::init();
+	Nnue::init();
 	Hexbitboard::init();
 	Attacks::init();
 	Commands::rotate = false;
 	MoveGen::reset_move_stack();
+	MoveGen::reset_game_stack();
+	TransTable::init();
+	Eval::clear_cache();
+	Search::init();
 	cout << ENGINE_NAME;
 }
 
@@ -238,11 +279,13 @@ void Commands::command_fen()
 			cout << "position is illegal\n";
 			Hexbitboard::restore_bitboards();
 			MoveGen::reset_move_stack();
+			MoveGen::reset_game_stack();
 			Attacks::init();
 		}
 		else {
 			cout << "position is legal\n";
 			MoveGen::reset_move_stack();
+			MoveGen::reset_game_stack();
 			Attacks::init();
 		}
 	}
@@ -250,9 +293,10 @@ void Commands::command_fen()
 
 void Commands::command_new()
 {
-	Hexbitboard::new_game();
 	MoveGen::white_to_move = true;
+	Hexbitboard::new_game();
 	MoveGen::reset_move_stack();
+	MoveGen::reset_game_stack();
 	Attacks::init();
 }
 
@@ -260,15 +304,19 @@ void Commands::command_edit()
 {
 	Hexbitboard::backup_bitboards();
 	edit();
+	Hexbitboard::update_key();
+	Eval::update_state();
 	if (!Attacks::position_is_ok()) {
 		cout << "position is illegal\n";
 		Hexbitboard::restore_bitboards();
 		MoveGen::reset_move_stack();
+		MoveGen::reset_game_stack();
 		Attacks::init();
 	}
 	else {
 		cout << "position is legal\n";
 		MoveGen::reset_move_stack();
+		MoveGen::reset_game_stack();
 		Attacks::init();
 	}
 }
@@ -378,15 +426,15 @@ void Commands::command_white()
 	MoveGen::white_to_move = true;
 	if (Attacks::position_is_ok()) {
 		cout << "position is legal\n";
-		MoveGen::reset_move_stack();
-		Attacks::init();
 	}
 	else {
 		cout << "position is illegal\n";
 		MoveGen::white_to_move = false;
-		MoveGen::reset_move_stack();
-		Attacks::init();
 	}
+	Hexbitboard::update_key();
+	MoveGen::reset_move_stack();
+	MoveGen::reset_game_stack();
+	Attacks::init();
 }
 
 void Commands::command_black()
@@ -394,15 +442,15 @@ void Commands::command_black()
 	MoveGen::white_to_move = false;
 	if (Attacks::position_is_ok()) {
 		cout << "position is legal\n";
-		MoveGen::reset_move_stack();
-		Attacks::init();
 	}
 	else {
 		cout << "position is illegal\n";
 		MoveGen::white_to_move = true;
-		MoveGen::reset_move_stack();
-		Attacks::init();
 	}
+	Hexbitboard::update_key();
+	MoveGen::reset_move_stack();
+	MoveGen::reset_game_stack();
+	Attacks::init();
 }
 
 void Commands::command_moves()
@@ -411,6 +459,441 @@ void Commands::command_moves()
 	cout << MoveGen::get_legal_moves();
 }
 
+void Commands::command_perft()
+{
+	uint32_t depth;
+	cin >> depth;
+	auto start = std::chrono::steady_clock::now();
+	MoveGen::reset_move_stack();
+	uint64_t nodes = MoveGen::perft(depth);
+	auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+	Attacks::init();
+	cout << "perft " << depth << " = " << nodes << " (" << elapsed.count() << " ms)" << endl;
+}
+
+void Commands::command_verify()
+{
+	uint32_t games, plies, depth;
+	cin >> games >> plies >> depth;
+	Verify::random_games(games, plies, depth);
+}
+
+void Commands::command_hash()
+{
+	uint64_t megabytes;
+	cin >> megabytes;
+	if (!TransTable::resize(megabytes)) {
+		cout << "cannot allocate " << megabytes << " MB\n";
+	}
+	cout << "hash " << TransTable::get_megabytes() << " MB, " << TransTable::get_memory_report() << endl;
+}
+
+void Commands::command_clearhash()
+{
+	TransTable::clear();
+}
+
+void Commands::command_hashfull()
+{
+	cout << "hashfull " << TransTable::hashfull() << " permille\n";
+}
+
+void Commands::command_numa()
+{
+	string mode;
+	uint32_t node = 0;
+	cin >> mode;
+	numa_policy policy;
+	if (mode == "off") {
+		policy = NUMA_OFF;
+	}
+	else if (mode == "interleave") {
+		policy = NUMA_INTERLEAVE;
+	}
+	else if (mode == "bind") {
+		cin >> node;
+		policy = NUMA_BIND;
+	}
+	else {
+		cout << "unknown numa mode: " << mode << endl;
+		return;
+	}
+	if (!LargeMemory::set_numa(policy, node)) {
+		cout << "no such numa node: " << node << endl;
+		return;
+	}
+	cout << "numa nodes " << LargeMemory::numa_nodes() << endl;
+	// placement only applies to new memory, so reallocate the hash
+	if (TransTable::resize(TransTable::get_megabytes())) {
+		cout << "hash " << TransTable::get_megabytes() << " MB, " << TransTable::get_memory_report() << endl;
+	}
+}
+
+void Commands::command_savehash()
+{
+	string file_name;
+	string rest;
+	uint32_t min_depth = 0;
+	cin >> file_name;
+	std::getline(cin, rest);
+	std::istringstream iss(rest);
+	iss >> min_depth;
+	if (min_depth > UINT8_MAX) {
+		cout << "depth must be between 0 and " << UINT8_MAX << endl;
+		return;
+	}
+	uint64_t saved;
+	if (TransTable::save(file_name, uint8_t(min_depth), saved)) {
+		cout << "saved " << saved << " entries\n";
+	}
+	else {
+		cout << "cannot write " << file_name << endl;
+	}
+}
+
+void Commands::command_loadhash()
+{
+	string file_name;
+	cin >> file_name;
+	uint64_t loaded;
+	if (TransTable::load(file_name, loaded)) {
+		cout << "loaded " << loaded << " entries\n";
+	}
+	else {
+		cout << "cannot read " << file_name << endl;
+	}
+}
+
+void Commands::command_eval()
+{
+	const eval_state state = Eval::get_state();
+	cout << "eval " << Eval::evaluate() << " (side to move)\n";
+	cout << "white: middlegame " << state.psq.mg << " endgame " << state.psq.eg << " phase " << state.phase
+		 << "/" << PHASE_MAX << endl;
+	const score_pair attacks = Eval::attack_terms();
+	cout << "white attacks: middlegame " << attacks.mg << " endgame " << attacks.eg << endl;
+	cout << "eval cache hits " << Eval::get_cache_hits() << " misses " << Eval::get_cache_misses() << endl;
+}
+
+void Commands::command_go()
+{
+	string rest, token;
+	std::getline(cin, rest);
+	std::istringstream iss(rest);
+	search_limits limits = {0, 0, 0, 0, 0, 0};
+	while (iss >> token) {
+		if (token == "depth") {
+			iss >> limits.depth;
+		}
+		else if (token == "time") {
+			iss >> limits.time;
+		}
+		else if (token == "nodes") {
+			iss >> limits.nodes;
+		}
+		else if (token == "clock") {
+			iss >> limits.clock;
+		}
+		else if (token == "inc") {
+			iss >> limits.increment;
+		}
+		else if (token == "movestogo") {
+			iss >> limits.moves_to_go;
+		}
+		else {
+			cout << "unknown go argument: " << token << endl;
+			return;
+		}
+	}
+	if (!limits.depth && !limits.time && !limits.nodes && !limits.clock) {
+		limits.time = DEFAULT_MOVE_TIME;
+	}
+	move_t best;
+	if (ponder_hit) {  // the ponder search already looks at this position
+		Search::ponder_hit(limits);
+		best = Search::wait_thinking();
+		ponder_hit = false;
+	}
+	else {
+		// a ponder search on another position is of no use for this one
+		stop_pondering();
+		best = Search::think(limits);
+	}
+	if (!best.move) {
+		cout << "no legal moves\n";
+		return;
+	}
+	move_t reply = Search::get_ponder_move();
+	cout << "bestmove " << MoveGen::move_to_str(best);
+	if (Search::get_ponder() && reply.move) {
+		cout << " ponder " << MoveGen::move_to_str(reply);
+	}
+	cout << endl;
+	// go leaves the board alone, pondering starts once the move is played
+	engine_move = best;
+	engine_key = Hexbitboard::get_key();
+	expected_move = reply;
+}
+
+void Commands::play(move_t move)
+{
+	MoveGen::make_move(move);
+	MoveGen::reset_move_stack();
+	Attacks::init();
+	if (MoveGen::is_repetition(2)) {
+		cout << "draw by threefold repetition\n";
+	}
+	else if (MoveGen::is_fifty_moves()) {
+		cout << "draw by fifty-move rule\n";
+	}
+}
+
+void Commands::stop_pondering()
+{
+	if (Search::is_thinking()) {
+		Search::stop_thinking();
+		ponder_hit = false;
+	}
+}
+
+/**
+ * plays a move of the game; the expected reply keeps the ponder search
+ * running for the next go, any other move aborts it; the engine's own
+ * bestmove starts pondering on the position after the expected reply
+ */
+void Commands::command_play()
+{
+	string text;
+	move_t move;
+	cin >> text;
+	if (!MoveGen::parse_move(text, move)) {
+		cout << "illegal move: " << text << endl;
+		return;
+	}
+	if (Search::is_thinking()) {
+		if (!ponder_hit && move.move == expected_move.move) {
+			ponder_hit = true;
+		}
+		else {
+			stop_pondering();
+		}
+	}
+	const bool own_move = engine_move.move && Hexbitboard::get_key() == engine_key
+			&& MoveGen::move_to_str(move) == MoveGen::move_to_str(engine_move);
+	engine_move.move = 0;
+	play(move);
+	if (!own_move || !Search::get_ponder() || !expected_move.move || Search::is_thinking()) {
+		return;
+	}
+	move_t reply;
+	if (MoveGen::parse_move(MoveGen::move_to_str(expected_move), reply)) {
+		expected_move = reply;
+		MoveGen::make_move(reply);
+		Search::start_pondering();
+		MoveGen::unmake_move();
+		Attacks::init();
+	}
+}
+
+void Commands::command_option()
+{
+	string rest, name, value;
+	std::getline(cin, rest);
+	std::istringstream iss(rest);
+	if (!(iss >> name)) {
+		cout << Search::get_options();
+		return;
+	}
+	iss >> value;
+	if ((value != "on" && value != "off") || !Search::set_option(name, value == "on")) {
+		cout << "unknown option: " << name << " " << value << endl;
+	}
+}
+
+void Commands::command_threads()
+{
+	string rest;
+	uint32_t number;
+	std::getline(cin, rest);
+	std::istringstream iss(rest);
+	if (iss >> number && !Search::set_threads(number)) {
+		cout << "threads must be between 1 and " << THREADS_MAX << endl;
+	}
+	cout << "threads " << Search::get_threads() << endl;
+}
+
+void Commands::command_multipv()
+{
+	string rest;
+	uint32_t number;
+	std::getline(cin, rest);
+	std::istringstream iss(rest);
+	if (iss >> number && !Search::set_multipv(number)) {
+		cout << "multipv must be between 1 and " << MULTIPV_MAX << endl;
+	}
+	cout << "multipv " << Search::get_multipv() << endl;
+}
+
+void Commands::command_scaling()
+{
+	string rest;
+	int32_t depth = 10;
+	std::getline(cin, rest);
+	std::istringstream iss(rest);
+	iss >> depth;
+	if (depth < 1 || depth >= MAX_PLY) {
+		cout << "depth must be between 1 and " << MAX_PLY - 1 << endl;
+		return;
+	}
+	Search::scaling(depth);
+}
+
+/**
+ * Texel tuning of the hand written evaluation, a file line is an xfen, the
+ * side to move and the game result, e.g. K8k/N7n w 1-0
+ */
+void Commands::command_tune()
+{
+	string rest, file_name, token;
+	uint32_t epochs = TUNE_EPOCHS_DEFAULT;
+	double rate = TUNE_RATE_DEFAULT;
+	uint32_t threads = Search::get_threads();
+	std::getline(cin, rest);
+	std::istringstream iss(rest);
+	if (!(iss >> file_name)) {
+		cout << "tune needs a file of labelled positions\n";
+		return;
+	}
+	while (iss >> token) {
+		if (token == "epochs") {
+			iss >> epochs;
+		}
+		else if (token == "rate") {
+			iss >> rate;
+		}
+		else if (token == "threads") {
+			iss >> threads;
+		}
+		else {
+			cout << "unknown tune argument: " << token << endl;
+			return;
+		}
+	}
+	if (threads < 1 || threads > THREADS_MAX) {
+		cout << "threads must be between 1 and " << THREADS_MAX << endl;
+		return;
+	}
+	if (Search::is_thinking()) {
+		cout << "stop the search first\n";
+		return;
+	}
+	if (Nnue::is_active()) {
+		cout << "tune fits the hand written evaluation, switch nnue off first\n";
+		return;
+	}
+	Tuner::tune(file_name, epochs, rate, threads);
+}
+
+/**
+ * loads a network or switches between it and the hand written evaluation;
+ * without arguments shows the state and the SIMD kernels of the CPU
+ */
+void Commands::command_nnue()
+{
+	string rest, action, argument;
+	std::getline(cin, rest);
+	std::istringstream iss(rest);
+	iss >> action >> argument;
+	if (action == "load") {
+		string error;
+		if (!Nnue::load(argument, error)) {
+			cout << error << endl;
+			return;
+		}
+	}
+	else if (action == "on" || action == "off") {
+		if (!Nnue::set_active(action == "on")) {
+			cout << "no network loaded\n";
+			return;
+		}
+	}
+	else if (action == "kernel") {
+		if (!Nnue::set_kernel(argument)) {
+			cout << "kernel not available: " << argument << endl;
+			return;
+		}
+	}
+	else if (!action.empty()) {
+		cout << "unknown nnue argument: " << action << endl;
+		return;
+	}
+	Eval::clear_cache();
+	cout << "nnue " << (Nnue::is_active() ? "on" : "off");
+	if (Nnue::is_loaded()) {
+		cout << ", network " << Nnue::get_file();
+	}
+	cout << ", kernel " << Nnue::get_kernel() << " (available: " << Nnue::get_kernels() << ")\n";
+}
+
+// prints the statistics of the last search, as json to the screen or a file
+void Commands::command_stats()
+{
+	string rest, format, file_name;
+	std::getline(cin, rest);
+	std::istringstream iss(rest);
+	if (!(iss >> format)) {
+		Stats::print();
+		return;
+	}
+	if (format != "json") {
+		cout << "unknown stats format: " << format << endl;
+		return;
+	}
+	if (!(iss >> file_name)) {
+		Stats::write_json(cout);
+		return;
+	}
+	if (!Stats::save_json(file_name)) {
+		cout << "cannot write " << file_name << endl;
+	}
+}
+
+void Commands::command_mate()
+{
+	string rest;
+	uint32_t moves = 0;
+	uint64_t megabytes = MATE_HASH_DEFAULT;
+	std::getline(cin, rest);
+	std::istringstream iss(rest);
+	iss >> moves >> megabytes;
+	if (moves < 1 || moves > MATE_MOVES_MAX) {
+		cout << "moves must be between 1 and " << MATE_MOVES_MAX << endl;
+		return;
+	}
+	if (megabytes < 1) {
+		megabytes = 1;
+	}
+	MateSolver::solve(moves, megabytes);
+}
+
+// a running search is stopped by the input thread already, here only pondering is left
+void Commands::command_stop()
+{
+	stop_pondering();
+}
+
+void Commands::command_slack()
+{
+	string rest;
+	uint64_t milliseconds;
+	std::getline(cin, rest);
+	std::istringstream iss(rest);
+	if (iss >> milliseconds) {
+		Search::set_slack(milliseconds);
+	}
+	cout << "slack " << Search::get_slack() << " ms\n";
+}
+
 void Commands::read_commands()
 {
 	string command_line;
@@ -424,7 +907,9 @@ void Commands::read_commands()
 			cout << " (black)>";
 		};
 		cout.flush();
-		cin >> command_line;
+		if (!(cin >> command_line)) {  // end of input
+			command_line = "quit";
+		}
 		command = nullptr;
 		int i = 0;
 		do {
@@ -435,6 +920,11 @@ void Commands::read_commands()
 			i++;
 		} while (command_list[i].name != "");
 		if (command) {
+			// a search in the background must not see the board or the hash change
+			if (command != command_play && command != command_go && command != command_display
+					&& command != command_help) {
+				stop_pondering();
+			}
 			command();
 		}
 		else {
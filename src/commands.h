@@ -28,6 +28,7 @@
 #include <iostream>
 #include <string>
 #include "hexbitboard.h"
+#include "movegen.h"
 
 
 struct command {
@@ -53,14 +54,41 @@ private:
 	static void command_black();
 	static void command_moves();
 	static void command_attacks();
+	static void command_perft();
+	static void command_verify();
+	static void command_hash();
+	static void command_clearhash();
+	static void command_hashfull();
+	static void command_numa();
+	static void command_savehash();
+	static void command_loadhash();
+	static void command_eval();
+	static void command_go();
+	static void command_play();
+	static void command_mate();
+	static void command_stop();
+	static void command_slack();
+	static void command_option();
+	static void command_threads();
+	static void command_multipv();
+	static void command_scaling();
+	static void command_tune();
+	static void command_stats();
+	static void command_nnue();
 	static std::string recode_display(std::string hexboard_display);
 	static std::string recode_attacks(const std::string hexboard_display);
 	static void edit();
+	static void play(move_t move);
+	static void stop_pondering();
 	static const std::string ENGINE_NAME;
 	static const command command_list[];
 	static const std::string hexboard_display_normal;
 	static const std::string hexboard_display_rotate;
 	static bool rotate;
+	static move_t expected_move;
+	static move_t engine_move;  // the last bestmove, playing it starts pondering
+	static uint64_t engine_key;  // position the bestmove was found in
+	static bool ponder_hit;
 
 	Commands(); // this is a static class
 };
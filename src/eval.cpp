@@ -0,0 +1,216 @@
+/*
+***************************************************************************
+**
+** Copyright (C) 2011 Zbigniew Sienkiewicz.
+** All rights reserved.
+**
+** Glaucus is Glinski's hexagonal chess engine.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+***************************************************************************
+*/
+
+#include <vector>
+#include "eval.h"
+#include "attacks.h"
+#include "hexbitboard.h"
+#include "movegen.h"
+
+score_pair Eval::psq_table[MEN_NUMBER][HEXES_NUMBER_MAX];
+int32_t Eval::phase_table[MEN_NUMBER];
+int32_t Eval::king_distance[HEXES_NUMBER_MAX];
+thread_local eval_state Eval::state;
+thread_local eval_entry Eval::cache[EVAL_CACHE_SIZE];
+thread_local uint64_t Eval::cache_hits = 0;
+thread_local uint64_t Eval::cache_misses = 0;
+
+Eval::Eval()
+{
+}
+
+/**
+ * fills the piece-square tables: knights by the hexes they attack on an
+ * empty board, kings by their distance in king moves from f6; both terms
+ * are symmetric, so black uses the same hexes with the sign turned
+ */
+void Eval::init()
+{
+	const int32_t far = 99;
+	std::vector<uint8_t> queue(1, HEX_F6);
+	for (uint32_t pos = 0; pos < HEXES_NUMBER_MAX; ++pos) {
+		king_distance[pos] = far;
+	}
+	king_distance[HEX_F6] = 0;
+	for (size_t i = 0; i < queue.size(); ++i) {
+		const uint8_t from = queue[i];
+		for (uint8_t to = 0; to < HEXES_NUMBER_MAX; ++to) {
+			if (king_distance[to] == far && Hexbitboard::is_set(Attacks::king_attacks[from], to)) {
+				king_distance[to] = king_distance[from] + 1;
+				queue.push_back(to);
+			}
+		}
+	}
+	for (uint32_t man = 0; man < MEN_NUMBER; ++man) {
+		phase_table[man] = 0;
+		for (uint32_t pos = 0; pos < HEXES_NUMBER_MAX; ++pos) {
+			psq_table[man][pos].mg = 0;
+			psq_table[man][pos].eg = 0;
+		}
+	}
+	for (uint8_t pos : queue) {
+		const int32_t mobility = Hexbitboard::count(Attacks::knight_attacks[pos]);
+		const score_pair knight = { KNIGHT_VALUE + KNIGHT_MOBILITY_MG * mobility, KNIGHT_VALUE_EG + KNIGHT_MOBILITY_EG * mobility };
+		const score_pair king = { KING_CENTER_MG * king_distance[pos], -KING_CENTER_EG * king_distance[pos] };
+		psq_table[Hexbitboard::men_index(WHITE_KNIGHT)][pos] = knight;
+		psq_table[Hexbitboard::men_index(BLACK_KNIGHT)][pos] = { -knight.mg, -knight.eg };
+		psq_table[Hexbitboard::men_index(WHITE_KING)][pos] = king;
+		psq_table[Hexbitboard::men_index(BLACK_KING)][pos] = { -king.mg, -king.eg };
+	}
+	phase_table[Hexbitboard::men_index(WHITE_KNIGHT)] = KNIGHT_PHASE;
+	phase_table[Hexbitboard::men_index(BLACK_KNIGHT)] = KNIGHT_PHASE;
+}
+
+// sums the terms of all men on the board, the incremental state must match it
+eval_state Eval::compute_state()
+{
+	eval_state result = { { 0, 0 }, 0 };
+	const men pieces[] = { WHITE_KING, WHITE_KNIGHT, BLACK_KING, BLACK_KNIGHT };
+	const bits128 boards[] = { Hexbitboard::get_white_king(), Hexbitboard::get_white_knight(),
+							   Hexbitboard::get_black_king(), Hexbitboard::get_black_knight() };
+	for (uint32_t i = 0; i < 4; ++i) {
+		const uint32_t man = Hexbitboard::men_index(pieces[i]);
+		for (uint8_t pos = HEX_A1; pos < HEXES_NUMBER_MAX; ++pos) {
+			if (Hexbitboard::is_set(boards[i], pos)) {
+				result.psq.mg += psq_table[man][pos].mg;
+				result.psq.eg += psq_table[man][pos].eg;
+				result.phase += phase_table[man];
+			}
+		}
+	}
+	return result;
+}
+
+bool Eval::state_is_ok()
+{
+	const eval_state full = compute_state();
+	return full.psq.mg == state.psq.mg && full.psq.eg == state.psq.eg && full.phase == state.phase;
+}
+
+// attacks on the king hex and the hexes around it, a hex hit twice counts twice
+int32_t Eval::king_danger(bits128 king, const attack_counts &enemy)
+{
+	const bits128 zone = Attacks::king_attacks[Hexbitboard::get_lsb(king)] | king;
+	return Hexbitboard::count(zone & enemy.once) + Hexbitboard::count(zone & enemy.twice)
+		   + Hexbitboard::count(zone & enemy.thrice);
+}
+
+// hexes the knights can go to that are neither own nor outnumbered by the enemy
+int32_t Eval::safe_mobility(bits128 knights, const bits128 own, const bits128 unsafe)
+{
+	int32_t result = 0;
+	uint8_t pos;
+	while ((pos = Hexbitboard::get_lsb_and_reset(knights))) {
+		result += Hexbitboard::count(Attacks::knight_attacks[pos] & ~own & ~unsafe);
+	}
+	return result;
+}
+
+/**
+ * terms taken from the attack counts of both sides, from white's point of
+ * view; a knight is counted as guarding the hex it moves to, which is close
+ * enough as another own man usually covers it as well
+ */
+score_pair Eval::attack_terms()
+{
+	const attack_counts &white = Attacks::count_attacks(true);
+	const attack_counts &black = Attacks::count_attacks(false);
+	const int32_t danger = king_danger(Hexbitboard::get_black_king(), white)
+						   - king_danger(Hexbitboard::get_white_king(), black);
+	const int32_t mobility = safe_mobility(Hexbitboard::get_white_knight(), Hexbitboard::get_white(), Attacks::outnumbered(black, white))
+							 - safe_mobility(Hexbitboard::get_black_knight(), Hexbitboard::get_black(), Attacks::outnumbered(white, black));
+	const score_pair result = { KING_DANGER_MG * danger + SAFE_MOBILITY_MG * mobility, SAFE_MOBILITY_EG * mobility };
+	return result;
+}
+
+/**
+ * counts the terms of the hand-crafted evaluation, with the weights from
+ * eval.h they give back its score up to rounding
+ */
+void Eval::trace(eval_trace &result)
+{
+	for (uint32_t term = 0; term < TERMS_NUMBER; ++term) {
+		result.term[term] = 0;
+	}
+	bits128 knights[2] = { Hexbitboard::get_white_knight(), Hexbitboard::get_black_knight() };
+	bits128 kings[2] = { Hexbitboard::get_white_king(), Hexbitboard::get_black_king() };
+	for (uint32_t side = 0; side < 2; ++side) {
+		const int32_t sign = side ? -1 : 1;
+		bits128 temp = knights[side];
+		uint8_t pos;
+		while ((pos = Hexbitboard::get_lsb_and_reset(temp))) {
+			result.term[TERM_KNIGHT] += sign;
+			result.term[TERM_MOBILITY] += sign * Hexbitboard::count(Attacks::knight_attacks[pos]);
+		}
+		result.term[TERM_KING_CENTER] += sign * king_distance[Hexbitboard::get_lsb(kings[side])];
+	}
+	const attack_counts &white = Attacks::count_attacks(true);
+	const attack_counts &black = Attacks::count_attacks(false);
+	result.term[TERM_KING_DANGER] = king_danger(kings[1], white) - king_danger(kings[0], black);
+	result.term[TERM_SAFE_MOBILITY] = safe_mobility(knights[0], Hexbitboard::get_white(), Attacks::outnumbered(black, white))
+									  - safe_mobility(knights[1], Hexbitboard::get_black(), Attacks::outnumbered(white, black));
+	result.phase = state.phase < PHASE_MAX ? state.phase : PHASE_MAX;
+}
+
+/**
+ * static evaluation from the side to move point of view, looked up in a
+ * direct mapped per-thread cache keyed by the position key first
+ */
+int32_t Eval::evaluate()
+{
+	uint64_t key = Hexbitboard::get_key();
+	eval_entry &entry = cache[key & (EVAL_CACHE_SIZE - 1)];
+	if (entry.key == key) {
+		cache_hits++;
+		return entry.score;
+	}
+	cache_misses++;
+	int32_t score;
+	if (Nnue::is_active()) {
+		score = Nnue::evaluate(MoveGen::white_to_move);
+	}
+	else {
+		const int32_t phase = state.phase < PHASE_MAX ? state.phase : PHASE_MAX;
+		const score_pair attacks = attack_terms();
+		const int32_t mg = state.psq.mg + attacks.mg;
+		const int32_t eg = state.psq.eg + attacks.eg;
+		score = (mg * phase + eg * (PHASE_MAX - phase)) / PHASE_MAX;
+		if (!MoveGen::white_to_move) {
+			score = -score;
+		}
+	}
+	entry.key = key;
+	entry.score = score;
+	return score;
+}
+
+void Eval::clear_cache()
+{
+	for (uint32_t i = 0; i < EVAL_CACHE_SIZE; ++i) {
+		cache[i].key = 0;
+		cache[i].score = 0;
+	}
+	cache_hits = 0;
+	cache_misses = 0;
+}
@@ -0,0 +1,137 @@
+/*
+***************************************************************************
+**
+** Copyright (C) 2011 Zbigniew Sienkiewicz.
+** All rights reserved.
+**
+** Glaucus is Glinski's hexagonal chess engine.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+***************************************************************************
+*/
+
+#ifndef EVAL_H
+#define EVAL_H
+
+#include <inttypes.h>
+#include "attacks.h"
+#include "hexbitboard.h"
+#include "nnue.h"
+
+const int32_t KNIGHT_VALUE = 300;
+const int32_t KNIGHT_VALUE_EG = 280;
+const int32_t KNIGHT_PHASE = 1;
+const int32_t PHASE_MAX = 4;  // two knights a side at the start
+const int32_t KNIGHT_MOBILITY_MG = 3;  // per hex the knight attacks on an empty board
+const int32_t KNIGHT_MOBILITY_EG = 2;
+const int32_t KING_CENTER_MG = -4;  // per king move from the centre, the king hides in the middlegame
+const int32_t KING_CENTER_EG = 8;
+const int32_t KING_DANGER_MG = 5;  // per enemy attack on the king zone, counted up to three times a hex
+const int32_t SAFE_MOBILITY_MG = 2;  // per hex a knight can go to without being outnumbered
+const int32_t SAFE_MOBILITY_EG = 3;
+const uint32_t EVAL_CACHE_SIZE = 1 << 14;  // entries, must be a power of two
+
+struct eval_entry {
+	uint64_t key;
+	int32_t score;
+};
+
+// middlegame and endgame score from white's point of view
+struct score_pair {
+	int32_t mg;
+	int32_t eg;
+};
+
+// the evaluation is linear in these terms, the tuner fits their weights
+enum eval_term {
+	TERM_KNIGHT,          // knights
+	TERM_MOBILITY,        // hexes the knights attack on an empty board
+	TERM_KING_CENTER,     // king moves from the centre
+	TERM_KING_DANGER,     // attacks on the enemy king zone
+	TERM_SAFE_MOBILITY,   // hexes the knights can go to safely
+	TERMS_NUMBER
+};
+
+// the terms of a position from white's point of view, white minus black
+struct eval_trace {
+	int32_t term[TERMS_NUMBER];
+	int32_t phase;  // clamped to PHASE_MAX
+};
+
+// kept up to date by make_move and unmake_move
+struct eval_state {
+	score_pair psq;  // material and piece-square terms
+	int32_t phase;   // PHASE_MAX for a full board, 0 for bare kings
+};
+
+/**
+ * Tapered evaluation: material and piece-square terms are summed into a
+ * middlegame and an endgame score as men move, king danger and safe
+ * mobility are added from the attack counts, and both are blended by the
+ * phase at evaluation time. A loaded network replaces them.
+ */
+class Eval
+{
+public:
+	static void init();
+	static int32_t evaluate();
+	static void add_man(const men piece, const uint8_t position)
+	{
+		const score_pair &value = psq_table[Hexbitboard::men_index(piece)][position];
+		state.psq.mg += value.mg;
+		state.psq.eg += value.eg;
+		state.phase += phase_table[Hexbitboard::men_index(piece)];
+	}
+	static void remove_man(const men piece, const uint8_t position)
+	{
+		const score_pair &value = psq_table[Hexbitboard::men_index(piece)][position];
+		state.psq.mg -= value.mg;
+		state.psq.eg -= value.eg;
+		state.phase -= phase_table[Hexbitboard::men_index(piece)];
+	}
+	static void move_man(const men piece, const uint8_t from, const uint8_t to)
+	{
+		const score_pair &before = psq_table[Hexbitboard::men_index(piece)][from];
+		const score_pair &after = psq_table[Hexbitboard::men_index(piece)][to];
+		state.psq.mg += after.mg - before.mg;
+		state.psq.eg += after.eg - before.eg;
+	}
+	static void update_state()
+	{
+		state = compute_state();
+		Nnue::refresh();
+	}
+	static bool state_is_ok();
+	static eval_state get_state() { return state; }
+	static score_pair attack_terms();
+	static void trace(eval_trace &result);
+	static void clear_cache();
+	static uint64_t get_cache_hits() { return cache_hits; }
+	static uint64_t get_cache_misses() { return cache_misses; }
+private:
+	Eval();
+	static eval_state compute_state();
+	static int32_t king_danger(bits128 king, const attack_counts &enemy);
+	static int32_t safe_mobility(bits128 knights, const bits128 own, const bits128 unsafe);
+	static score_pair psq_table[MEN_NUMBER][HEXES_NUMBER_MAX];  // black men count negative
+	static int32_t phase_table[MEN_NUMBER];
+	static int32_t king_distance[HEXES_NUMBER_MAX];  // king moves from f6
+	static thread_local eval_state state;
+	static thread_local eval_entry cache[EVAL_CACHE_SIZE];
+	static thread_local uint64_t cache_hits;
+	static thread_local uint64_t cache_misses;
+};
+
+#endif // EVAL_H
@@ -28,14 +28,21 @@
 #include "hexbitboard.h"
 #include "utils.h"
 #include "bitscan.h"
+#include "movegen.h"
+#include "eval.h"
 
 using namespace std;
 
-bitmaps Hexbitboard::bitboard;
-bitmaps Hexbitboard::bitboard_backup;
+thread_local bitmaps Hexbitboard::bitboard;
+thread_local bitmaps Hexbitboard::bitboard_backup;
 const bits128 Hexbitboard::singlemask(1ULL,0ULL);
 const bits128 Hexbitboard::zeromask(0ULL,0ULL);
 const uint16_t Hexbitboard::RANK_WIDTH = 11;
+thread_local uint64_t Hexbitboard::key = 0;
+thread_local uint8_t Hexbitboard::en_passant = 0;
+uint64_t Hexbitboard::zobrist_men[MEN_NUMBER][HEXES_NUMBER_MAX];
+uint64_t Hexbitboard::zobrist_en_passant[HEXES_NUMBER_MAX];
+uint64_t Hexbitboard::zobrist_side;
 
 Hexbitboard::Hexbitboard()
 {
@@ -43,9 +50,67 @@ Hexbitboard::Hexbitboard()
 
 void Hexbitboard::init()
 {
+	init_zobrist();
 	new_game();
 }
 
+/**
+ * fills Zobrist tables from a fixed seed (splitmix64), so keys are the
+ * same in every run and can be stored on disk
+ */
+void Hexbitboard::init_zobrist()
+{
+	uint64_t seed = 0x676C617563757331ULL;
+	auto next = [&seed]() {
+		uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	};
+	for (uint32_t i = 0; i < MEN_NUMBER; ++i) {
+		for (uint32_t pos = 0; pos < HEXES_NUMBER_MAX; ++pos) {
+			zobrist_men[i][pos] = next();
+		}
+	}
+	for (uint32_t pos = 0; pos < HEXES_NUMBER_MAX; ++pos) {
+		zobrist_en_passant[pos] = next();
+	}
+	zobrist_side = next();
+}
+
+/**
+ * computes the position key from scratch, make_move/unmake_move keep it
+ * up to date incrementally
+ */
+uint64_t Hexbitboard::compute_key()
+{
+	uint64_t result = 0;
+	uint8_t pos;
+	bits128 temp = bitboard.white_king;
+	while ((pos = get_lsb_and_reset(temp))) {
+		result ^= zobrist_men[men_index(WHITE_KING)][pos];
+	}
+	temp = bitboard.white_knight;
+	while ((pos = get_lsb_and_reset(temp))) {
+		result ^= zobrist_men[men_index(WHITE_KNIGHT)][pos];
+	}
+	temp = bitboard.black_king;
+	while ((pos = get_lsb_and_reset(temp))) {
+		result ^= zobrist_men[men_index(BLACK_KING)][pos];
+	}
+	temp = bitboard.black_knight;
+	while ((pos = get_lsb_and_reset(temp))) {
+		result ^= zobrist_men[men_index(BLACK_KNIGHT)][pos];
+	}
+	if (en_passant) {  // no pawns yet, so this stays empty
+		result ^= zobrist_en_passant[en_passant];
+	}
+	if (!MoveGen::white_to_move) {
+		result ^= zobrist_side;
+	}
+	return result;
+}
+
 void Hexbitboard::new_game()
 {
 	setup_board("///N7n///K8k/N7n");
@@ -127,12 +192,14 @@ bool Hexbitboard::setup_board(string xfen)
 		return false;
 	}
 	set_white_black();
+	update_key();
+	Eval::update_state();
 	return true;
 }
 
 bool Hexbitboard::hex_is_ok(const int64_t file, const int64_t rank)
 {
-	if ((file > 10) || (rank > 10)) {
+	if ((file < 0) || (rank < 0) || (file > 10) || (rank > 10)) {
 		return false;
 	}
 	switch (file) {
@@ -170,9 +237,53 @@ bool Hexbitboard::hex_is_ok(const int64_t file, const int64_t rank)
 }
 
 
+std::string Hexbitboard::get_xfen()
+{
+	string columns[FILE_L + 1];
+	uint32_t last_file = FILE_A;
+	for (uint32_t file = FILE_A; file <= FILE_L; ++file) {
+		ostringstream column;
+		uint32_t empty = 0;
+		for (uint32_t rank = RANK_1; hex_is_ok(file, rank); ++rank) {
+			uint32_t pos = (file + HEX_A1) + rank * RANK_WIDTH;
+			char man;
+			if (is_set_white_king(pos)) {
+				man = 'K';
+			}
+			else if (is_set_white_knight(pos)) {
+				man = 'N';
+			}
+			else if (is_set_black_king(pos)) {
+				man = 'k';
+			}
+			else if (is_set_black_knight(pos)) {
+				man = 'n';
+			}
+			else {
+				empty++;
+				continue;
+			}
+			if (empty) {
+				column << empty;
+				empty = 0;
+			}
+			column << man;
+			last_file = file;
+		}
+		columns[file] = column.str();
+	}
+	string xfen = columns[FILE_A];
+	for (uint32_t file = FILE_B; file <= last_file; ++file) {
+		xfen += '/' + columns[file];
+	}
+	return xfen;
+}
+
 void Hexbitboard::restore_bitboards()
 {
 	bitboard = bitboard_backup;
+	update_key();
+	Eval::update_state();
 }
 
 void Hexbitboard::backup_bitboards()
@@ -185,6 +296,14 @@ bitmaps Hexbitboard::get_bitboards()
 	return bitboard;
 }
 
+// copies a position into this thread's board, side to move must be set first
+void Hexbitboard::set_bitboards(const bitmaps &board)
+{
+	bitboard = board;
+	update_key();
+	Eval::update_state();
+}
+
 bool Hexbitboard::is_set(const uint64_t position)
 {
 	if ((bitboard.black_pieces & (singlemask << position)) || (bitboard.white_pieces & (singlemask << position))) {
@@ -408,14 +527,13 @@ std::string Hexbitboard::get_men(const uint64_t position)
 uint8_t Hexbitboard::get_lsb_and_reset(bits128 &piece)
 {
 	uint8_t pos;
-	if (!piece) {
-		return 0;
-	}
-	else if (piece.lo && (pos = Bitscan::get_lsb(piece.lo))) {
+	if (piece.lo) {
+		pos = Bitscan::get_lsb(piece.lo);
 		piece.lo &= (piece.lo-1);
 		return pos;
 	}
-	else if (piece.hi && (pos = Bitscan::get_lsb(piece.hi))) {
+	else if (piece.hi) {  // bit 0 of hi is HEX_L5, so test the word, not the index
+		pos = Bitscan::get_lsb(piece.hi);
 		piece.hi &= (piece.hi-1);
 		return pos+64;
 	}
@@ -424,19 +542,20 @@ uint8_t Hexbitboard::get_lsb_and_reset(bits128 &piece)
 
 uint8_t Hexbitboard::get_lsb(bits128 &piece)
 {
-	uint8_t pos;
-	if (!piece) {
-		return 0;
+	if (piece.lo) {
+		return Bitscan::get_lsb(piece.lo);
 	}
-	else if (piece.lo && (pos = Bitscan::get_lsb(piece.lo))) {
-		return pos;
-	}
-	else if (piece.hi && (pos = Bitscan::get_lsb(piece.hi))) {
-		return pos+64;
+	else if (piece.hi) {
+		return Bitscan::get_lsb(piece.hi)+64;
 	}
 	return 0;
 }
 
+uint8_t Hexbitboard::count(const bits128 piece)
+{
+	return Bitscan::popcount(piece.lo) + Bitscan::popcount(piece.hi);
+}
+
 std::string Hexbitboard::pos_to_str(const uint8_t pos)
 {
 	assert(pos > 9);
@@ -456,7 +575,7 @@ bits128 operator<<(bits128 board, uint64_t val)
 		board.hi = board.lo << (val-64);
 		board.lo = 0;
 	}
-	else {
+	else if (val > 0) {  // a shift by 64 is undefined
 		board.hi = (board.hi << val) | (board.lo >> (64 - val));
 		board.lo = board.lo << val;
 	}
@@ -469,7 +588,7 @@ bits128* operator<<=(bits128 &board, uint64_t val)
 		board.hi = board.lo << (val-64);
 		board.lo = 0;
 	}
-	else {
+	else if (val > 0) {  // a shift by 64 is undefined
 		board.hi = (board.hi << val) | (board.lo >> (64 - val));
 		board.lo = board.lo << val;
 	}
@@ -511,6 +630,16 @@ bits128 operator~(bits128 board)
 	return board;
 }
 
+bool operator==(bits128 board, bits128 mask)
+{
+	return (board.lo == mask.lo) && (board.hi == mask.hi);
+}
+
+bool operator!=(bits128 board, bits128 mask)
+{
+	return !(board == mask);
+}
+
 bits128::operator bool()
 {
 	if ((lo) || (hi)) {
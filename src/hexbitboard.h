@@ -29,7 +29,7 @@
 #include <string>
 #include <iostream>
 
-//const uint32_t HEXES_NUMBER_ALIGN = 126;
+const uint32_t HEXES_NUMBER_MAX = 126;
 
 enum hexes_std:uint8_t {
 	HEX_A1=10, HEX_B1=11, HEX_C1=12, HEX_D1=13, HEX_E1=14, HEX_F1=15, HEX_G1=16, HEX_H1=17, HEX_I1=18, HEX_K1=19, HEX_L1=20,
@@ -46,7 +46,9 @@ enum hexes_std:uint8_t {
 };
 
 enum men { EMPTY=0, WHITE_KING=1, WHITE_KNIGHT=2, WHITE_BISHOP=4, WHITE_ROOK=8, WHITE_QUEEN=16, WHITE_PAWN=32,
-		   BLACK_KING=64, BLACK_KNIGHT=128, BLACK_BISHOP=256, BLACK_ROOK=512, BLACK_QUEEN=1024, BLACK_PAWN=2056 };
+		   BLACK_KING=64, BLACK_KNIGHT=128, BLACK_BISHOP=256, BLACK_ROOK=512, BLACK_QUEEN=1024, BLACK_PAWN=2048 };
+
+const uint32_t MEN_NUMBER = 12;
 
 enum files { FILE_A, FILE_B, FILE_C, FILE_D, FILE_E, FILE_F, FILE_G, FILE_H, FILE_I, FILE_K, FILE_L };
 
@@ -114,6 +116,8 @@ bits128* operator&=(bits128 &board, bits128 mask);
 bits128 operator&(bits128 board, bits128 mask);
 bits128 operator|(bits128 board, bits128 mask);
 bits128 operator~(bits128 board);
+bool operator==(bits128 board, bits128 mask);
+bool operator!=(bits128 board, bits128 mask);
 
 class Hexbitboard
 {
@@ -151,22 +155,39 @@ public:
 	static bits128 get_black_knight() { return bitboard.black_knight; }
 	static std::string get_men(const uint64_t position);
 	static bitmaps get_bitboards();
+	static void set_bitboards(const bitmaps &board);
 	static bool setup_board(const std::string fen);
+	static std::string get_xfen();
 	static bool hex_is_ok(const int64_t file, const int64_t rank);
 	static uint8_t get_lsb_and_reset(bits128 &piece);
 	static uint8_t get_lsb(bits128 &piece);
+	static uint8_t count(const bits128 piece);
 	static std::string pos_to_str(const uint8_t pos);
 	static bool is_capture() { return (bitboard.white_pieces & bitboard.black_pieces); }
 	static void backup_bitboards();
 	static void restore_bitboards();
+	static uint64_t get_key() { return key; }
+	static uint64_t compute_key();
+	static void update_key() { key = compute_key(); }
+	static void hash_man(const men piece, const uint64_t position) { key ^= zobrist_men[men_index(piece)][position]; }
+	static void hash_side() { key ^= zobrist_side; }
+	static uint64_t zobrist_signature() { return zobrist_side ^ zobrist_men[0][HEX_A1] ^ zobrist_en_passant[HEX_F11]; }
+	static constexpr uint32_t men_index(const uint32_t piece, const uint32_t index = 0)
+	{ return (piece & 1) ? index : men_index(piece >> 1, index + 1); }
 	static const uint16_t RANK_WIDTH;
 
 private:
 	Hexbitboard(); // so far private
 	static const bits128 singlemask;
 	static const bits128 zeromask;
-	static bitmaps bitboard;
-	static bitmaps bitboard_backup;
+	static thread_local bitmaps bitboard;
+	static thread_local bitmaps bitboard_backup;
+	static thread_local uint64_t key;
+	static thread_local uint8_t en_passant;
+	static uint64_t zobrist_men[MEN_NUMBER][HEXES_NUMBER_MAX];
+	static uint64_t zobrist_en_passant[HEXES_NUMBER_MAX];
+	static uint64_t zobrist_side;
+	static void init_zobrist();
 	static bool set_piece(const men piece, const uint32_t file, const uint32_t rank);
 };
 
@@ -0,0 +1,94 @@
+/*
+***************************************************************************
+**
+** Copyright (C) 2011 Zbigniew Sienkiewicz.
+** All rights reserved.
+**
+** Glaucus is Glinski's hexagonal chess engine.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+***************************************************************************
+*/
+
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include "input.h"
+#include "search.h"
+
+LineBuffer Input::buffer;
+std::streambuf *Input::original = nullptr;
+
+void LineBuffer::push(const std::string &line)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	lines.push_back(line + '\n');
+	ready.notify_one();
+}
+
+void LineBuffer::close()
+{
+	// notified under the lock: the buffer may be destroyed at exit as
+	// soon as the command loop sees the end of input
+	std::lock_guard<std::mutex> lock(mutex);
+	closed = true;
+	ready.notify_one();
+}
+
+// waits for the next line when the current one is used up
+LineBuffer::int_type LineBuffer::underflow()
+{
+	if (gptr() < egptr()) {
+		return traits_type::to_int_type(*gptr());
+	}
+	std::unique_lock<std::mutex> lock(mutex);
+	ready.wait(lock, [this] { return !lines.empty() || closed; });
+	if (lines.empty()) {
+		return traits_type::eof();
+	}
+	current = lines.front();
+	lines.pop_front();
+	setg(&current[0], &current[0], &current[0] + current.size());
+	return traits_type::to_int_type(*gptr());
+}
+
+Input::Input()
+{
+}
+
+void Input::start()
+{
+	original = std::cin.rdbuf(&buffer);
+	std::thread(reader).detach();
+}
+
+/**
+ * passes every line on to the command loop; a 'stop' also sets the stop
+ * flag of a search in progress right away
+ */
+void Input::reader()
+{
+	std::istream in(original);
+	std::string line;
+	while (std::getline(in, line)) {
+		std::istringstream words(line);
+		std::string word, extra;
+		if (words >> word && word == "stop" && !(words >> extra) && Search::is_searching()) {
+			Search::request_stop();
+		}
+		buffer.push(line);
+	}
+	buffer.close();
+}
@@ -0,0 +1,68 @@
+/*
+***************************************************************************
+**
+** Copyright (C) 2011 Zbigniew Sienkiewicz.
+** All rights reserved.
+**
+** Glaucus is Glinski's hexagonal chess engine.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+***************************************************************************
+*/
+
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <streambuf>
+#include <string>
+
+/**
+ * Stream buffer filled line by line by the input thread; it replaces the
+ * buffer of std::cin, so commands go on reading their arguments with >>
+ */
+class LineBuffer : public std::streambuf
+{
+public:
+	void push(const std::string &line);
+	void close();
+protected:
+	int_type underflow() override;
+private:
+	std::mutex mutex;
+	std::condition_variable ready;
+	std::deque<std::string> lines;
+	std::string current;
+	bool closed = false;
+};
+
+/**
+ * Dedicated input thread: reads standard input while the engine thinks
+ * and stops a running search as soon as a 'stop' line arrives
+ */
+class Input
+{
+public:
+	static void start();
+private:
+	Input();
+	static void reader();
+	static LineBuffer buffer;
+	static std::streambuf *original;
+};
+
+#endif // INPUT_H
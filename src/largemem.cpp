@@ -0,0 +1,250 @@
+/*
+***************************************************************************
+**
+** Copyright (C) 2011 Zbigniew Sienkiewicz.
+** All rights reserved.
+**
+** Glaucus is Glinski's hexagonal chess engine.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+***************************************************************************
+*/
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "largemem.h"
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using std::string;
+
+numa_policy LargeMemory::policy = NUMA_OFF;
+uint32_t LargeMemory::bind_node = 0;
+bool LargeMemory::explicit_pages = false;
+
+#if defined(__linux__)
+// from linux/mempolicy.h, libnuma is not needed for a single mbind call
+const int MEMORY_POLICY_BIND = 2;
+const int MEMORY_POLICY_INTERLEAVE = 3;
+#endif
+
+LargeMemory::LargeMemory()
+{
+}
+
+/**
+ * @return ids of the online NUMA nodes, the list may have gaps; node 0
+ * alone when it cannot be determined
+ */
+std::vector<uint32_t> LargeMemory::online_nodes()
+{
+	std::vector<uint32_t> nodes;
+	std::ifstream online("/sys/devices/system/node/online");
+	string ranges;
+	if (online >> ranges) {
+		std::istringstream list(ranges);
+		string range;
+		while (std::getline(list, range, ',')) {
+			size_t dash = range.find('-');
+			uint32_t first = uint32_t(std::stoul(range.substr(0, dash)));
+			uint32_t last = (dash == string::npos) ? first : uint32_t(std::stoul(range.substr(dash + 1)));
+			for (uint32_t node = first; node <= last; ++node) {
+				nodes.push_back(node);
+			}
+		}
+	}
+	if (nodes.empty()) {
+		nodes.push_back(0);
+	}
+	return nodes;
+}
+
+bool LargeMemory::set_numa(const numa_policy new_policy, const uint32_t node)
+{
+	if (new_policy == NUMA_BIND) {
+		const std::vector<uint32_t> nodes = online_nodes();
+		if (std::find(nodes.begin(), nodes.end(), node) == nodes.end()) {
+			return false;
+		}
+	}
+	policy = new_policy;
+	bind_node = node;
+	return true;
+}
+
+/**
+ * looks up how much of the mapping holding memory is backed by
+ * transparent huge pages
+ */
+uint64_t LargeMemory::huge_kilobytes(const void *memory)
+{
+	std::ifstream smaps("/proc/self/smaps");
+	string line;
+	bool inside = false;
+	uintptr_t address = reinterpret_cast<uintptr_t>(memory);
+	while (std::getline(smaps, line)) {
+		unsigned long long from, to;
+		char dash;
+		std::istringstream header(line);
+		if (line.find(':') > line.find(' ') && (header >> std::hex >> from >> dash >> to) && dash == '-') {
+			inside = (address >= from && address < to);
+			continue;
+		}
+		if (inside && line.compare(0, 14, "AnonHugePages:") == 0) {
+			return std::stoull(line.substr(14));
+		}
+	}
+	return 0;
+}
+
+/**
+ * allocates size bytes aligned to LARGE_PAGE_SIZE, zeroed and prefaulted
+ * @param report describes the pages and placement actually obtained
+ * @return nullptr if nothing could be allocated
+ */
+void *LargeMemory::allocate(const uint64_t size, string &report)
+{
+	std::ostringstream text;
+	void *memory = nullptr;
+	uint64_t length = (size + LARGE_PAGE_SIZE - 1) & ~(LARGE_PAGE_SIZE - 1);
+
+#if defined(__linux__) && defined(MAP_HUGETLB)
+	memory = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	explicit_pages = (memory != MAP_FAILED);
+	if (!explicit_pages) {
+		// over-allocate and trim, so transparent huge pages can back the whole block
+		void *raw = mmap(nullptr, length + LARGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (raw == MAP_FAILED) {
+			return nullptr;
+		}
+		uintptr_t start = reinterpret_cast<uintptr_t>(raw);
+		uintptr_t aligned = (start + LARGE_PAGE_SIZE - 1) & ~uintptr_t(LARGE_PAGE_SIZE - 1);
+		if (aligned > start) {
+			munmap(raw, aligned - start);
+		}
+		munmap(reinterpret_cast<void *>(aligned + length), start + LARGE_PAGE_SIZE - aligned);
+		memory = reinterpret_cast<void *>(aligned);
+#if defined(MADV_HUGEPAGE)
+		madvise(memory, length, MADV_HUGEPAGE);
+#endif
+	}
+
+	const std::vector<uint32_t> online = online_nodes();
+	const uint32_t nodes = uint32_t(online.size());
+	if (policy != NUMA_OFF && nodes > 1) {
+		// one bit per node id, in as many words as the highest id needs
+		const uint32_t word_bits = sizeof(unsigned long) * 8;
+		std::vector<unsigned long> mask(*std::max_element(online.begin(), online.end()) / word_bits + 1, 0UL);
+		for (uint32_t node : online) {
+			if (policy != NUMA_BIND || node == bind_node) {
+				mask[node / word_bits] |= 1UL << (node % word_bits);
+			}
+		}
+		int mode = (policy == NUMA_BIND) ? MEMORY_POLICY_BIND : MEMORY_POLICY_INTERLEAVE;
+		// the kernel reads one bit less than maxnode says
+		if (syscall(SYS_mbind, memory, length, mode, mask.data(), mask.size() * word_bits + 1, 0) == 0) {
+			if (policy == NUMA_BIND) {
+				text << ", bound to node " << bind_node;
+			}
+			else {
+				text << ", interleaved over " << nodes << " nodes";
+			}
+		}
+		else {
+			text << ", numa placement failed";
+		}
+	}
+#else
+	memory = std::malloc(length + LARGE_PAGE_SIZE);
+	if (!memory) {
+		return nullptr;
+	}
+	// keep the raw pointer just below the aligned block for release()
+	uintptr_t aligned = (reinterpret_cast<uintptr_t>(memory) + LARGE_PAGE_SIZE) & ~uintptr_t(LARGE_PAGE_SIZE - 1);
+	reinterpret_cast<void **>(aligned)[-1] = memory;
+	memory = reinterpret_cast<void *>(aligned);
+#endif
+
+	clear(memory, length);
+
+	std::ostringstream pages;
+#if defined(__linux__)
+	if (explicit_pages) {
+		pages << "explicit 2 MB pages";
+	}
+	else {
+		uint64_t huge = huge_kilobytes(memory) >> 10;
+		if (huge) {
+			pages << "transparent huge pages " << huge << " of " << (length >> 20) << " MB";
+		}
+		else {
+			pages << "normal pages";
+		}
+	}
+#else
+	pages << "normal pages";
+#endif
+	report = pages.str() + text.str();
+	return memory;
+}
+
+void LargeMemory::release(void *memory, const uint64_t size)
+{
+	if (!memory) {
+		return;
+	}
+#if defined(__linux__) && defined(MAP_HUGETLB)
+	munmap(memory, (size + LARGE_PAGE_SIZE - 1) & ~(LARGE_PAGE_SIZE - 1));
+#else
+	(void)size;
+	std::free(reinterpret_cast<void **>(memory)[-1]);
+#endif
+}
+
+/**
+ * zeroes memory in page sized slices from all hardware threads, which
+ * also makes the first touch of a new block parallel
+ */
+void LargeMemory::clear(void *memory, const uint64_t size)
+{
+	uint64_t threads = std::thread::hardware_concurrency();
+	uint64_t slices = size / LARGE_PAGE_SIZE;
+	if (threads < 2 || slices < 2) {
+		std::memset(memory, 0, size);
+		return;
+	}
+	if (threads > slices) {
+		threads = slices;
+	}
+	uint64_t chunk = (slices / threads) * LARGE_PAGE_SIZE;
+	std::vector<std::thread> workers;
+	for (uint64_t i = 0; i < threads; ++i) {
+		uint64_t start = i * chunk;
+		uint64_t length = (i == threads - 1) ? size - start : chunk;
+		workers.emplace_back([=]() { std::memset(static_cast<char *>(memory) + start, 0, length); });
+	}
+	for (auto &worker : workers) {
+		worker.join();
+	}
+}
@@ -0,0 +1,58 @@
+/*
+***************************************************************************
+**
+** Copyright (C) 2011 Zbigniew Sienkiewicz.
+** All rights reserved.
+**
+** Glaucus is Glinski's hexagonal chess engine.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+***************************************************************************
+*/
+
+#ifndef LARGEMEM_H
+#define LARGEMEM_H
+
+#include <inttypes.h>
+#include <string>
+#include <vector>
+
+const uint64_t LARGE_PAGE_SIZE = 2ULL << 20;
+
+enum numa_policy { NUMA_OFF, NUMA_INTERLEAVE, NUMA_BIND };
+
+/**
+ * Allocator for big engine tables. On Linux it tries explicit 2 MB pages,
+ * then transparent huge pages, optionally interleaves or binds the block
+ * across NUMA nodes and first-touches it from several threads.
+ */
+class LargeMemory
+{
+public:
+	static void *allocate(const uint64_t size, std::string &report);
+	static void release(void *memory, const uint64_t size);
+	static void clear(void *memory, const uint64_t size);
+	static bool set_numa(const numa_policy policy, const uint32_t node);
+	static uint32_t numa_nodes() { return uint32_t(online_nodes().size()); }
+	static std::vector<uint32_t> online_nodes();
+private:
+	LargeMemory();
+	static uint64_t huge_kilobytes(const void *memory);
+	static numa_policy policy;
+	static uint32_t bind_node;
+	static bool explicit_pages;
+};
+
+#endif // LARGEMEM_H
@@ -0,0 +1,288 @@
+/*
+***************************************************************************
+**
+** Copyright (C) 2011 Zbigniew Sienkiewicz.
+** All rights reserved.
+**
+** Glaucus is Glinski's hexagonal chess engine.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+***************************************************************************
+*/
+
+#include <cassert>
+#include "mailbox.h"
+
+men Mailbox::board[HEXES_NUMBER_MAX];
+move_t Mailbox::game_stack[GAME_STACK_SIZE];
+men Mailbox::captured_stack[GAME_STACK_SIZE];
+int Mailbox::game_top = 0;
+bool Mailbox::white_to_move = true;
+
+// steps are given in axial coordinates (file, file-independent rank),
+// see step() for the conversion from the board's own file/rank system
+const int64_t Mailbox::king_steps[12][2] = {
+	{ 0, 1}, { 0,-1}, { 1, 0}, {-1, 0}, { 1,-1}, {-1, 1},  // orthogonal
+	{ 2,-1}, {-2, 1}, { 1, 1}, {-1,-1}, { 1,-2}, {-1, 2}   // diagonal
+};
+
+const int64_t Mailbox::knight_steps[12][2] = {
+	{ 1, 2}, { 2, 1}, { 1,-3}, {-3, 1}, { 2,-3}, {-3, 2},
+	{-1,-2}, {-2,-1}, {-1, 3}, { 3,-1}, {-2, 3}, { 3,-2}
+};
+
+Mailbox::Mailbox()
+{
+}
+
+void Mailbox::load()
+{
+	for (uint32_t pos = 0; pos < HEXES_NUMBER_MAX; ++pos) {
+		board[pos] = EMPTY;
+	}
+	for (int64_t file = FILE_A; file <= FILE_L; ++file) {
+		for (int64_t rank = RANK_1; Hexbitboard::hex_is_ok(file, rank); ++rank) {
+			uint32_t pos = uint32_t(file + HEX_A1 + rank * Hexbitboard::RANK_WIDTH);
+			if (Hexbitboard::is_set_white_king(pos)) {
+				board[pos] = WHITE_KING;
+			}
+			else if (Hexbitboard::is_set_white_knight(pos)) {
+				board[pos] = WHITE_KNIGHT;
+			}
+			else if (Hexbitboard::is_set_black_king(pos)) {
+				board[pos] = BLACK_KING;
+			}
+			else if (Hexbitboard::is_set_black_knight(pos)) {
+				board[pos] = BLACK_KNIGHT;
+			}
+		}
+	}
+	white_to_move = MoveGen::white_to_move;
+	game_top = 0;
+}
+
+bitmaps Mailbox::get_bitboards()
+{
+	bitmaps result;
+	for (uint32_t pos = 0; pos < HEXES_NUMBER_MAX; ++pos) {
+		switch (board[pos]) {
+		case WHITE_KING:
+			result.white_king.set(pos);
+			result.white_pieces.set(pos);
+			break;
+		case WHITE_KNIGHT:
+			result.white_knight.set(pos);
+			result.white_pieces.set(pos);
+			break;
+		case BLACK_KING:
+			result.black_king.set(pos);
+			result.black_pieces.set(pos);
+			break;
+		case BLACK_KNIGHT:
+			result.black_knight.set(pos);
+			result.black_pieces.set(pos);
+			break;
+		default:
+			break;
+		}
+	}
+	return result;
+}
+
+/**
+ * Moves from a hex by a step given in axial coordinates. Files left of
+ * the f-file are skewed: their rank 1 lies higher on the board, so the
+ * file-independent rank is rank - (file - f) there.
+ * @return false if the step leaves the board
+ */
+bool Mailbox::step(const uint8_t from, const int64_t d_file, const int64_t d_rank, uint8_t &to)
+{
+	assert(from >= HEX_A1);
+	int64_t file = (from - HEX_A1) % Hexbitboard::RANK_WIDTH;
+	int64_t rank = (from - HEX_A1) / Hexbitboard::RANK_WIDTH;
+	int64_t q = file - FILE_F;
+	int64_t r = (q >= 0) ? rank : rank - q;
+	q += d_file;
+	r += d_rank;
+	file = q + FILE_F;
+	rank = (q >= 0) ? r : r + q;
+	if (!Hexbitboard::hex_is_ok(file, rank)) {
+		return false;
+	}
+	to = uint8_t(file + HEX_A1 + rank * Hexbitboard::RANK_WIDTH);
+	return true;
+}
+
+bits128 Mailbox::attacks(const color_to_move side)
+{
+	bits128 result;
+	men king = (side == WHITE) ? WHITE_KING : BLACK_KING;
+	men knight = (side == WHITE) ? WHITE_KNIGHT : BLACK_KNIGHT;
+	uint8_t to;
+	for (uint8_t pos = HEX_A1; pos < HEXES_NUMBER_MAX; ++pos) {
+		if (board[pos] == king) {
+			for (uint32_t i = 0; i < 12; ++i) {
+				if (step(pos, king_steps[i][0], king_steps[i][1], to)) {
+					result.set(to);
+				}
+			}
+		}
+		else if (board[pos] == knight) {
+			for (uint32_t i = 0; i < 12; ++i) {
+				if (step(pos, knight_steps[i][0], knight_steps[i][1], to)) {
+					result.set(to);
+				}
+			}
+		}
+	}
+	return result;
+}
+
+// how many men of the side attack each hex
+void Mailbox::count_attacks(const color_to_move side, uint32_t counts[HEXES_NUMBER_MAX])
+{
+	men king = (side == WHITE) ? WHITE_KING : BLACK_KING;
+	men knight = (side == WHITE) ? WHITE_KNIGHT : BLACK_KNIGHT;
+	uint8_t to;
+	for (uint8_t pos = 0; pos < HEXES_NUMBER_MAX; ++pos) {
+		counts[pos] = 0;
+	}
+	for (uint8_t pos = HEX_A1; pos < HEXES_NUMBER_MAX; ++pos) {
+		if (board[pos] == king) {
+			for (uint32_t i = 0; i < 12; ++i) {
+				if (step(pos, king_steps[i][0], king_steps[i][1], to)) {
+					counts[to]++;
+				}
+			}
+		}
+		else if (board[pos] == knight) {
+			for (uint32_t i = 0; i < 12; ++i) {
+				if (step(pos, knight_steps[i][0], knight_steps[i][1], to)) {
+					counts[to]++;
+				}
+			}
+		}
+	}
+}
+
+bool Mailbox::king_is_attacked(const color_to_move side)
+{
+	men king = (side == WHITE) ? WHITE_KING : BLACK_KING;
+	bits128 enemy = attacks(side == WHITE ? BLACK : WHITE);
+	for (uint8_t pos = HEX_A1; pos < HEXES_NUMBER_MAX; ++pos) {
+		if (board[pos] == king && enemy.is_set(pos)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+uint64_t Mailbox::generate_moves(move_t *moves)
+{
+	color_to_move side = white_to_move ? WHITE : BLACK;
+	men own_king = white_to_move ? WHITE_KING : BLACK_KING;
+	men own_knight = white_to_move ? WHITE_KNIGHT : BLACK_KNIGHT;
+	men opposite_king = white_to_move ? BLACK_KING : WHITE_KING;
+	uint64_t count = 0;
+	uint8_t to;
+	for (uint8_t pos = HEX_A1; pos < HEXES_NUMBER_MAX; ++pos) {
+		const int64_t (*steps)[2];
+		piece p;
+		if (board[pos] == own_king) {
+			steps = king_steps;
+			p = KING;
+		}
+		else if (board[pos] == own_knight) {
+			steps = knight_steps;
+			p = KNIGHT;
+		}
+		else {
+			continue;
+		}
+		for (uint32_t i = 0; i < 12; ++i) {
+			if (!step(pos, steps[i][0], steps[i][1], to)) {
+				continue;
+			}
+			if (board[to] == own_king || board[to] == own_knight || board[to] == opposite_king) {
+				continue;
+			}
+			assert(count < MAILBOX_MOVES_MAX);
+			moves[count].set[COLOR_PIECE] = side | p;
+			moves[count].set[PIECE_FROM] = pos;
+			moves[count].set[PIECE_TO] = to;
+			moves[count].set[MOVE_TYPE] = 0;
+			count++;
+		}
+	}
+	return count;
+}
+
+uint64_t Mailbox::generate_legal_moves(move_t *moves)
+{
+	move_t pseudo[MAILBOX_MOVES_MAX];
+	uint64_t total = generate_moves(pseudo);
+	uint64_t count = 0;
+	for (uint64_t i = 0; i < total; ++i) {
+		move_t move = pseudo[i];
+		if (make_move(move)) {
+			moves[count++] = pseudo[i];
+		}
+		unmake_move();
+	}
+	return count;
+}
+
+bool Mailbox::make_move(move_t &move)
+{
+	assert(game_top < int(GAME_STACK_SIZE));
+	men captured = board[move.set[PIECE_TO]];
+	if (captured != EMPTY) {
+		move.set[MOVE_TYPE] |= (CAPTURING | GET_KNIGHT);
+	}
+	board[move.set[PIECE_TO]] = board[move.set[PIECE_FROM]];
+	board[move.set[PIECE_FROM]] = EMPTY;
+	captured_stack[game_top] = captured;
+	game_stack[game_top++] = move;
+	color_to_move side = white_to_move ? WHITE : BLACK;
+	white_to_move = !white_to_move;
+	return !king_is_attacked(side);
+}
+
+void Mailbox::unmake_move()
+{
+	assert(game_top > 0);
+	game_top--;
+	move_t move = game_stack[game_top];
+	board[move.set[PIECE_FROM]] = board[move.set[PIECE_TO]];
+	board[move.set[PIECE_TO]] = captured_stack[game_top];
+	white_to_move = !white_to_move;
+}
+
+uint64_t Mailbox::perft(const uint32_t depth)
+{
+	if (depth == 0) {
+		return 1;
+	}
+	move_t moves[MAILBOX_MOVES_MAX];
+	uint64_t total = generate_moves(moves);
+	uint64_t nodes = 0;
+	for (uint64_t i = 0; i < total; ++i) {
+		if (make_move(moves[i])) {
+			nodes += perft(depth - 1);
+		}
+		unmake_move();
+	}
+	return nodes;
+}
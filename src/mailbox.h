@@ -0,0 +1,66 @@
+/*
+***************************************************************************
+**
+** Copyright (C) 2011 Zbigniew Sienkiewicz.
+** All rights reserved.
+**
+** Glaucus is Glinski's hexagonal chess engine.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+***************************************************************************
+*/
+
+#ifndef MAILBOX_H
+#define MAILBOX_H
+
+#include <inttypes.h>
+#include "hexbitboard.h"
+#include "attacks.h"
+#include "movegen.h"
+
+const uint64_t MAILBOX_MOVES_MAX = 256;
+
+/**
+ * Deliberately simple reference move generator. The board is a plain
+ * array of men and every step is made in hex coordinates and validated
+ * by Hexbitboard::hex_is_ok, so it shares no tables with Attacks and can
+ * be used to cross check the bitboard generator.
+ */
+class Mailbox
+{
+public:
+	static void load();
+	static bitmaps get_bitboards();
+	static bool step(const uint8_t from, const int64_t d_file, const int64_t d_rank, uint8_t &to);
+	static bits128 attacks(const color_to_move side);
+	static void count_attacks(const color_to_move side, uint32_t counts[HEXES_NUMBER_MAX]);
+	static uint64_t generate_moves(move_t *moves);
+	static uint64_t generate_legal_moves(move_t *moves);
+	static bool make_move(move_t &move);
+	static void unmake_move();
+	static uint64_t perft(const uint32_t depth);
+	static bool white_to_move;
+private:
+	Mailbox();
+	static bool king_is_attacked(const color_to_move side);
+	static men board[HEXES_NUMBER_MAX];
+	static move_t game_stack[GAME_STACK_SIZE];
+	static men captured_stack[GAME_STACK_SIZE];
+	static int game_top;
+	static const int64_t king_steps[12][2];
+	static const int64_t knight_steps[12][2];
+};
+
+#endif // MAILBOX_H
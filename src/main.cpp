@@ -25,9 +25,11 @@
 #include <iostream>
 #include <string>
 #include "commands.h"
+#include "input.h"
 
 
 int main() {
+	Input::start();
 	Commands::command_init();
 	Commands::read_commands();
 	//return 0;
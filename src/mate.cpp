@@ -0,0 +1,259 @@
+/*
+***************************************************************************
+**
+** Copyright (C) 2011 Zbigniew Sienkiewicz.
+** All rights reserved.
+**
+** Glaucus is Glinski's hexagonal chess engine.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+***************************************************************************
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <vector>
+#include "mate.h"
+#include "hexbitboard.h"
+#include "attacks.h"
+#include "movegen.h"
+#include "largemem.h"
+
+using std::cout;
+using std::endl;
+
+pn_entry *MateSolver::table = nullptr;
+uint64_t MateSolver::buckets = 0;
+uint64_t MateSolver::nodes = 0;
+
+MateSolver::MateSolver()
+{
+}
+
+// the same position is a different problem with a different number of plies left
+uint64_t MateSolver::entry_key(const uint64_t key, const uint32_t plies)
+{
+	return key ^ (uint64_t(plies + 1) * 0x9E3779B97F4A7C15ULL);
+}
+
+bool MateSolver::lookup(const uint64_t key, const uint32_t plies, uint32_t &pn, uint32_t &dn)
+{
+	const uint64_t full_key = entry_key(key, plies);
+	pn_entry *bucket = table + (full_key & (buckets - 1)) * MATE_BUCKET_SIZE;
+	for (uint32_t i = 0; i < MATE_BUCKET_SIZE; ++i) {
+		if (bucket[i].key == full_key) {
+			pn = bucket[i].pn;
+			dn = bucket[i].dn;
+			return true;
+		}
+	}
+	return false;
+}
+
+void MateSolver::store(const uint64_t key, const uint32_t plies, const uint32_t pn, const uint32_t dn, const uint64_t work)
+{
+	const uint64_t full_key = entry_key(key, plies);
+	pn_entry *bucket = table + (full_key & (buckets - 1)) * MATE_BUCKET_SIZE;
+	pn_entry *replace = bucket;
+	for (uint32_t i = 0; i < MATE_BUCKET_SIZE; ++i) {
+		if (bucket[i].key == full_key) {
+			replace = bucket + i;
+			break;
+		}
+		if (bucket[i].work < replace->work) {
+			replace = bucket + i;
+		}
+	}
+	replace->key = full_key;
+	replace->pn = pn;
+	replace->dn = dn;
+	replace->work = uint32_t(std::min<uint64_t>(work, UINT32_MAX));
+}
+
+/**
+ * legal checks when the attacker is to move (odd number of plies left),
+ * all legal moves for the defender
+ */
+void MateSolver::generate(const uint32_t plies)
+{
+	Attacks::generate_moves();
+	MoveGen::remove_unlegal_moves();
+	if (plies & 1) {
+		MoveGen::keep_checks();
+	}
+}
+
+/**
+ * expands the node until its phi or delta reaches the threshold; phi and
+ * delta are the proof and disproof numbers seen from the side to move
+ */
+void MateSolver::mid(const uint32_t plies, const uint32_t phi_threshold, const uint32_t delta_threshold,
+					 uint32_t &phi, uint32_t &delta)
+{
+	nodes++;
+	const uint64_t first_node = nodes;
+	const bool attacker = plies & 1;
+	const uint64_t key = Hexbitboard::get_key();
+	uint64_t bottom = MoveGen::open_ply();
+	generate(plies);
+	const uint64_t first = MoveGen::get_move_bottom();
+	const uint64_t count = MoveGen::get_move_top() - first;
+
+	if (!count || !plies) {
+		// an attacker without checks has failed, a defender without evasions in check is mated
+		const bool wins = !attacker && (count || !Attacks::in_check());
+		phi = wins ? 0 : PN_INFINITE;
+		delta = wins ? PN_INFINITE : 0;
+		MoveGen::close_ply(bottom);
+		store(key, plies, attacker ? phi : delta, attacker ? delta : phi, 1);
+		return;
+	}
+
+	// numbers of the children are kept here, so that a child pushed out of
+	// the table cannot make the node loop
+	std::vector<uint32_t> child_phi(count, 1), child_delta(count, 1);
+	for (uint64_t i = 0; i < count; ++i) {
+		move_t move = MoveGen::get_move(first + i);
+		uint32_t pn, dn;
+		MoveGen::make_move(move);
+		if (lookup(Hexbitboard::get_key(), plies - 1, pn, dn)) {
+			child_phi[i] = attacker ? dn : pn;
+			child_delta[i] = attacker ? pn : dn;
+		}
+		MoveGen::unmake_move();
+	}
+
+	while (true) {
+		phi = PN_INFINITE;
+		delta = 0;
+		uint64_t best = 0;
+		uint32_t best_delta = PN_INFINITE + 1;
+		uint32_t second_delta = PN_INFINITE;
+		for (uint64_t i = 0; i < count; ++i) {
+			if (child_delta[i] < best_delta) {
+				second_delta = best_delta;
+				best_delta = child_delta[i];
+				best = i;
+			}
+			else if (child_delta[i] < second_delta) {
+				second_delta = child_delta[i];
+			}
+			phi = std::min(phi, child_delta[i]);
+			delta = std::min(PN_INFINITE, delta + child_phi[i]);
+		}
+		if (phi >= phi_threshold || delta >= delta_threshold) {
+			break;
+		}
+		const uint32_t phi_limit = std::min(PN_INFINITE, delta_threshold - delta + child_phi[best]);
+		const uint32_t delta_limit = std::min(phi_threshold, std::min(PN_INFINITE, second_delta + 1));
+		move_t move = MoveGen::get_move(first + best);
+		MoveGen::make_move(move);
+		mid(plies - 1, phi_limit, delta_limit, child_phi[best], child_delta[best]);
+		MoveGen::unmake_move();
+	}
+	MoveGen::close_ply(bottom);
+	store(key, plies, attacker ? phi : delta, attacker ? delta : phi, nodes - first_node + 1);
+}
+
+/**
+ * follows proved children: any mating move for the attacker, the best
+ * defended evasion (most work spent on it) for the defender
+ */
+std::string MateSolver::principal_variation(const uint32_t plies)
+{
+	std::string text;
+	uint32_t made = 0;
+	for (uint32_t left = plies; left > 0; --left) {
+		uint64_t bottom = MoveGen::open_ply();
+		generate(left);
+		move_t chosen;
+		chosen.move = 0;
+		uint32_t most_work = 0;
+		for (uint64_t i = MoveGen::get_move_bottom(); i < MoveGen::get_move_top(); ++i) {
+			move_t move = MoveGen::get_move(i);
+			MoveGen::make_move(move);
+			const uint64_t full_key = entry_key(Hexbitboard::get_key(), left - 1);
+			const pn_entry *bucket = table + (full_key & (buckets - 1)) * MATE_BUCKET_SIZE;
+			for (uint32_t j = 0; j < MATE_BUCKET_SIZE; ++j) {
+				if (bucket[j].key == full_key && bucket[j].pn == 0 && (!chosen.move || bucket[j].work > most_work)) {
+					chosen = move;
+					most_work = bucket[j].work;
+				}
+			}
+			MoveGen::unmake_move();
+			if (chosen.move && (left & 1)) {
+				break;
+			}
+		}
+		MoveGen::close_ply(bottom);
+		if (!chosen.move) {
+			break;
+		}
+		text += " " + MoveGen::move_to_str(chosen);
+		MoveGen::make_move(chosen);
+		made++;
+	}
+	while (made--) {
+		MoveGen::unmake_move();
+	}
+	return text;
+}
+
+/**
+ * looks for the shortest mate of the side to move in up to the given
+ * number of moves, proving mate in 1, 2, ... in turn with one table
+ */
+void MateSolver::solve(const uint32_t moves, const uint64_t megabytes)
+{
+	buckets = 1;
+	while ((buckets * 2) * MATE_BUCKET_SIZE * sizeof(pn_entry) <= (megabytes << 20)) {
+		buckets *= 2;
+	}
+	const uint64_t size = buckets * MATE_BUCKET_SIZE * sizeof(pn_entry);
+	std::string report;
+	table = static_cast<pn_entry *>(LargeMemory::allocate(size, report));
+	if (!table) {
+		cout << "cannot allocate " << megabytes << " MB\n";
+		return;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	nodes = 0;
+	MoveGen::reset_move_stack();
+	uint32_t found = 0;
+	std::string line;
+	for (uint32_t n = 1; n <= moves && !found; ++n) {
+		uint32_t phi, delta;
+		mid(2 * n - 1, PN_INFINITE, PN_INFINITE, phi, delta);
+		if (phi == 0) {
+			found = n;
+			line = principal_variation(2 * n - 1);
+		}
+	}
+	uint64_t time = uint64_t(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+	if (found) {
+		cout << "mate in " << found << ":" << line;
+	}
+	else {
+		cout << "no mate in " << moves;
+	}
+	cout << " (nodes " << nodes << ", " << time << " ms, " << (size >> 10) << " kB table)" << endl;
+
+	LargeMemory::release(table, size);
+	table = nullptr;
+	MoveGen::reset_move_stack();
+	Attacks::init();
+}
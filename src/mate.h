@@ -0,0 +1,67 @@
+/*
+***************************************************************************
+**
+** Copyright (C) 2011 Zbigniew Sienkiewicz.
+** All rights reserved.
+**
+** Glaucus is Glinski's hexagonal chess engine.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+***************************************************************************
+*/
+
+#ifndef MATE_H
+#define MATE_H
+
+#include <inttypes.h>
+#include <string>
+
+const uint32_t PN_INFINITE = 100000000;
+const uint32_t MATE_MOVES_MAX = 16;
+const uint64_t MATE_HASH_DEFAULT = 16;  // MB
+const uint32_t MATE_BUCKET_SIZE = 4;
+
+struct pn_entry {
+	uint64_t key;   // position key mixed with the plies left
+	uint32_t pn;    // proof number, 0 when the mate is proved
+	uint32_t dn;    // disproof number, 0 when there is no mate
+	uint32_t work;  // nodes spent below the entry, the cheapest one is replaced
+};
+
+/**
+ * Depth-first proof-number (df-pn) solver for mates in a given number of
+ * moves. The attacker tries only checking moves, the defender every
+ * evasion; proof and disproof numbers live in a table of their own whose
+ * size caps the memory used.
+ */
+class MateSolver
+{
+public:
+	static void solve(const uint32_t moves, const uint64_t megabytes);
+private:
+	MateSolver();
+	static void mid(const uint32_t plies, const uint32_t phi_threshold, const uint32_t delta_threshold,
+					uint32_t &phi, uint32_t &delta);
+	static void generate(const uint32_t plies);
+	static bool lookup(const uint64_t key, const uint32_t plies, uint32_t &pn, uint32_t &dn);
+	static void store(const uint64_t key, const uint32_t plies, const uint32_t pn, const uint32_t dn, const uint64_t work);
+	static uint64_t entry_key(const uint64_t key, const uint32_t plies);
+	static std::string principal_variation(const uint32_t plies);
+	static pn_entry *table;
+	static uint64_t buckets;
+	static uint64_t nodes;
+};
+
+#endif // MATE_H
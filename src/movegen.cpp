@@ -27,18 +27,23 @@
 #include "movegen.h"
 #include "hexbitboard.h"
 #include "attacks.h"
+#include "eval.h"
+#include "nnue.h"
 #include "utils.h"
 
 using std::cout;
 using std::endl;
 
-uint64_t MoveGen::move_top = 0;
-uint64_t MoveGen::move_bottom = 0;
-int MoveGen::game_top = 0;
-bool MoveGen::white_to_move = true;
+thread_local uint64_t MoveGen::move_top = 0;
+thread_local uint64_t MoveGen::move_bottom = 0;
+thread_local int MoveGen::game_top = 0;
+thread_local bool MoveGen::white_to_move = true;
 
-move_t MoveGen::move_stack[MOVE_STACK_SIZE];
-move_t MoveGen::game_stack[GAME_STACK_SIZE];
+thread_local move_t MoveGen::move_stack[MOVE_STACK_SIZE];
+thread_local int32_t MoveGen::score_stack[MOVE_STACK_SIZE];
+thread_local move_t MoveGen::game_stack[GAME_STACK_SIZE];
+thread_local uint64_t MoveGen::key_stack[GAME_STACK_SIZE + 1];
+thread_local uint32_t MoveGen::halfmove_stack[GAME_STACK_SIZE + 1];
 
 MoveGen::MoveGen()
 {
@@ -54,6 +59,7 @@ void MoveGen::add_move(const color_to_move c, const piece p, const uint8_t from,
 	move_stack[move_top].set[PIECE_FROM] = from;
 	move_stack[move_top].set[PIECE_TO] = to;
 	move_stack[move_top].set[MOVE_TYPE] = 0;
+	score_stack[move_top] = 0;
 	move_top++;
 }
 
@@ -63,22 +69,118 @@ void MoveGen::reset_move_stack()
 	move_bottom = 0;
 }
 
+// the current position starts the game, called whenever the board is set up
+void MoveGen::reset_game_stack()
+{
+	game_top = 0;
+	key_stack[0] = Hexbitboard::get_key();
+	halfmove_stack[0] = 0;
+	Nnue::refresh();  // its accumulator stack follows the game stack
+}
+
+/**
+ * keys of the positions since the last capture, the current one last;
+ * all a copy of the position in another thread needs to find repetitions
+ */
+std::vector<uint64_t> MoveGen::get_history()
+{
+	return std::vector<uint64_t>(key_stack + game_top - halfmove_stack[game_top], key_stack + game_top + 1);
+}
+
+void MoveGen::set_history(const std::vector<uint64_t> &keys)
+{
+	assert(!keys.empty() && keys.size() <= GAME_STACK_SIZE);
+	assert(keys.back() == Hexbitboard::get_key());
+	game_top = int(keys.size()) - 1;
+	for (int i = 0; i <= game_top; ++i) {
+		game_stack[i].move = 0;
+		key_stack[i] = keys[i];
+		halfmove_stack[i] = uint32_t(i);
+	}
+}
+
+/**
+ * whether the current position occurred count times before; only every
+ * second ply back to the last capture can hold the same position
+ */
+bool MoveGen::is_repetition(const int count)
+{
+	const uint64_t key = key_stack[game_top];
+	const int last_capture = game_top - int(halfmove_stack[game_top]);
+	int found = 0;
+	// a position needs at least two moves of each side to come back
+	for (int i = game_top - 4; i >= last_capture; i -= 2) {
+		if (key_stack[i] == key && ++found == count) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * starts a new move list on top of the current one, so that nested
+ * searches can generate moves without clobbering their parents
+ * @return bottom of the previous list, to be passed to close_ply()
+ */
+uint64_t MoveGen::open_ply()
+{
+	uint64_t bottom = move_bottom;
+	move_bottom = move_top;
+	return bottom;
+}
+
+void MoveGen::close_ply(const uint64_t bottom)
+{
+	move_top = move_bottom;
+	move_bottom = bottom;
+}
+
+/**
+ * incremental selection sort step: brings the best scored move of
+ * i..top to position i, so a cutoff saves sorting the rest
+ */
+move_t MoveGen::pick_move(const uint64_t i)
+{
+	uint64_t best = i;
+	for (uint64_t j = i + 1; j < move_top; ++j) {
+		if (score_stack[j] > score_stack[best]) {
+			best = j;
+		}
+	}
+	if (best != i) {
+		move_t move = move_stack[i];
+		move_stack[i] = move_stack[best];
+		move_stack[best] = move;
+		int32_t score = score_stack[i];
+		score_stack[i] = score_stack[best];
+		score_stack[best] = score;
+	}
+	return move_stack[i];
+}
+
+std::string MoveGen::move_to_str(const move_t move)
+{
+	std::string text;
+	switch (move.set[COLOR_PIECE] & 0xFCU) {  // unset color bits
+	case KING:
+		text = "K";
+		break;
+	case KNIGHT:
+		text = "N";
+		break;
+	default:
+		text = "?";
+	}
+	text += Hexbitboard::pos_to_str(move.set[PIECE_FROM]);
+	text += Hexbitboard::pos_to_str(move.set[PIECE_TO]);
+	return text;
+}
+
 std::string MoveGen::get_moves()
 {
 	std::ostringstream list;
 	for (uint64_t i = move_bottom; i < move_top; ++i) {
-		switch (move_stack[i].set[COLOR_PIECE] & 0xFCU) {  // unset color bits
-		case KING:
-			list << " K";
-			break;
-		case KNIGHT:
-			list << " N";
-			break;
-		default:
-			list << " ?";
-		}
-		list << Hexbitboard::pos_to_str(move_stack[i].set[1]);
-		list << Hexbitboard::pos_to_str(move_stack[i].set[2]);
+		list << " " << move_to_str(move_stack[i]);
 	}
 
 	list << "\ntotal number of moves = " << (move_top - move_bottom);
@@ -86,6 +188,27 @@ std::string MoveGen::get_moves()
 	return list.str();
 }
 
+/**
+ * finds the legal move written as by move_to_str, e.g. Kg1e1
+ * @return false if there is no such move in the position
+ */
+bool MoveGen::parse_move(const std::string text, move_t &move)
+{
+	bool found = false;
+	uint64_t bottom = open_ply();
+	Attacks::generate_moves();
+	remove_unlegal_moves();
+	for (uint64_t i = move_bottom; i < move_top; ++i) {
+		if (move_to_str(move_stack[i]) == text) {
+			move = move_stack[i];
+			found = true;
+			break;
+		}
+	}
+	close_ply(bottom);
+	return found;
+}
+
 std::string MoveGen::get_legal_moves()
 {
 	uint64_t legal_moves = remove_unlegal_moves();
@@ -108,6 +231,7 @@ uint64_t MoveGen::remove_unlegal_moves()
 		if (!make_move(move_stack[i])) {
 			unmake_move();
 			move_stack[i] = move_stack[--move_top];
+			score_stack[i] = score_stack[move_top];
 			i--;
 		}
 		else {
@@ -117,6 +241,22 @@ uint64_t MoveGen::remove_unlegal_moves()
 	return (move_top - move_bottom);
 }
 
+// drops the moves that do not give check, the list must be legal already
+uint64_t MoveGen::keep_checks()
+{
+	for (uint64_t i = move_bottom; i < move_top; ++i) {
+		make_move(move_stack[i]);
+		bool check = Attacks::in_check();
+		unmake_move();
+		if (!check) {
+			move_stack[i] = move_stack[--move_top];
+			score_stack[i] = score_stack[move_top];
+			i--;
+		}
+	}
+	return (move_top - move_bottom);
+}
+
 bool MoveGen::make_move(move_t &move)
 {
 	// update bitboard piece from
@@ -128,12 +268,18 @@ bool MoveGen::make_move(move_t &move)
 		case KING:
 			//cout << " +K" << Hexbitboard::pos_to_str(move.set[PIECE_TO]);
 			Hexbitboard::set_white_king(move.set[PIECE_TO]);
+			Hexbitboard::hash_man(WHITE_KING, move.set[PIECE_FROM]);
+			Hexbitboard::hash_man(WHITE_KING, move.set[PIECE_TO]);
+			Eval::move_man(WHITE_KING, move.set[PIECE_FROM], move.set[PIECE_TO]);
 			break;
 		case KNIGHT:
 			//cout << " -N" << Hexbitboard::pos_to_str(move.set[PIECE_FROM]);
 			Hexbitboard::unset_white_knight(move.set[PIECE_FROM]);
 			//cout << " +N" << Hexbitboard::pos_to_str(move.set[PIECE_TO]);
 			Hexbitboard::set_white_knight(move.set[PIECE_TO]);
+			Hexbitboard::hash_man(WHITE_KNIGHT, move.set[PIECE_FROM]);
+			Hexbitboard::hash_man(WHITE_KNIGHT, move.set[PIECE_TO]);
+			Eval::move_man(WHITE_KNIGHT, move.set[PIECE_FROM], move.set[PIECE_TO]);
 			break;
 		default:
 			assert(false);
@@ -146,14 +292,23 @@ bool MoveGen::make_move(move_t &move)
 			if (Hexbitboard::get_white() & Hexbitboard::get_black_knight()) {
 				//cout << "\t -N*" << Hexbitboard::pos_to_str(move.set[PIECE_TO]);
 				Hexbitboard::unset_black_knight(move.set[PIECE_TO]);
+				Hexbitboard::hash_man(BLACK_KNIGHT, move.set[PIECE_TO]);
+				Eval::remove_man(BLACK_KNIGHT, move.set[PIECE_TO]);
 				move.set[MOVE_TYPE] |= (CAPTURING | GET_KNIGHT);
 			}
 			Hexbitboard::set_black();
 			//cout << endl;
 		}
+		Nnue::push(move);
+		assert(game_top < int(GAME_STACK_SIZE));
 		game_stack[game_top++] = move;
 		Attacks::generate_opponent_attacks();
 		white_to_move = !white_to_move;
+		Hexbitboard::hash_side();
+		assert(Hexbitboard::get_key() == Hexbitboard::compute_key());
+		assert(Eval::state_is_ok());
+		key_stack[game_top] = Hexbitboard::get_key();
+		halfmove_stack[game_top] = (move.set[MOVE_TYPE] & CAPTURING) ? 0 : halfmove_stack[game_top - 1] + 1;
 		if (Hexbitboard::get_white_king() & Attacks::enemy_attacks()) {
 			return false;
 		}
@@ -165,10 +320,16 @@ bool MoveGen::make_move(move_t &move)
 		switch (move.set[COLOR_PIECE] & 0xFCU) { // unset color bits
 		case KING:
 			Hexbitboard::set_black_king(move.set[PIECE_TO]);
+			Hexbitboard::hash_man(BLACK_KING, move.set[PIECE_FROM]);
+			Hexbitboard::hash_man(BLACK_KING, move.set[PIECE_TO]);
+			Eval::move_man(BLACK_KING, move.set[PIECE_FROM], move.set[PIECE_TO]);
 			break;
 		case KNIGHT:
 			Hexbitboard::unset_black_knight(move.set[PIECE_FROM]);
 			Hexbitboard::set_black_knight(move.set[PIECE_TO]);
+			Hexbitboard::hash_man(BLACK_KNIGHT, move.set[PIECE_FROM]);
+			Hexbitboard::hash_man(BLACK_KNIGHT, move.set[PIECE_TO]);
+			Eval::move_man(BLACK_KNIGHT, move.set[PIECE_FROM], move.set[PIECE_TO]);
 			break;
 		default:
 			assert(false);
@@ -178,13 +339,22 @@ bool MoveGen::make_move(move_t &move)
 		if (Hexbitboard::is_capture()) {
 			if (Hexbitboard::get_black() & Hexbitboard::get_white_knight()) {
 				Hexbitboard::unset_white_knight(move.set[PIECE_TO]);
+				Hexbitboard::hash_man(WHITE_KNIGHT, move.set[PIECE_TO]);
+				Eval::remove_man(WHITE_KNIGHT, move.set[PIECE_TO]);
 				move.set[MOVE_TYPE] |= (CAPTURING | GET_KNIGHT);
 			}
 			Hexbitboard::set_white();
 		}
+		Nnue::push(move);
+		assert(game_top < int(GAME_STACK_SIZE));
 		game_stack[game_top++] = move;
 		Attacks::generate_opponent_attacks();
 		white_to_move = !white_to_move;
+		Hexbitboard::hash_side();
+		assert(Hexbitboard::get_key() == Hexbitboard::compute_key());
+		assert(Eval::state_is_ok());
+		key_stack[game_top] = Hexbitboard::get_key();
+		halfmove_stack[game_top] = (move.set[MOVE_TYPE] & CAPTURING) ? 0 : halfmove_stack[game_top - 1] + 1;
 		if (Hexbitboard::get_black_king() & Attacks::enemy_attacks()) {
 			return false;
 		}
@@ -198,6 +368,7 @@ void MoveGen::unmake_move()
 {
 	assert(game_top > 0);
 	move_t move = game_stack[--game_top];
+	Nnue::pop();
 	// update bitboard piece from
 	// update bitboard piece to (if capture set capture field and captured piece)
 	if (move.set[COLOR_PIECE] & WHITE) {
@@ -207,12 +378,18 @@ void MoveGen::unmake_move()
 		case KING:
 			//cout << " +K" << Hexbitboard::pos_to_str(move.set[PIECE_FROM]);
 			Hexbitboard::set_white_king(move.set[PIECE_FROM]); // restore king position
+			Hexbitboard::hash_man(WHITE_KING, move.set[PIECE_TO]);
+			Hexbitboard::hash_man(WHITE_KING, move.set[PIECE_FROM]);
+			Eval::move_man(WHITE_KING, move.set[PIECE_TO], move.set[PIECE_FROM]);
 			break;
 		case KNIGHT:
 			//cout << " -N" << Hexbitboard::pos_to_str(move.set[PIECE_TO]);
 			Hexbitboard::unset_white_knight(move.set[PIECE_TO]);
 			//cout << " +N" << Hexbitboard::pos_to_str(move.set[PIECE_FROM]);
 			Hexbitboard::set_white_knight(move.set[PIECE_FROM]); // restore knight position
+			Hexbitboard::hash_man(WHITE_KNIGHT, move.set[PIECE_TO]);
+			Hexbitboard::hash_man(WHITE_KNIGHT, move.set[PIECE_FROM]);
+			Eval::move_man(WHITE_KNIGHT, move.set[PIECE_TO], move.set[PIECE_FROM]);
 			break;
 		default:
 			assert(false);
@@ -224,6 +401,8 @@ void MoveGen::unmake_move()
 			if (move.set[MOVE_TYPE] & GET_KNIGHT) {
 				//cout << " +N*" << Hexbitboard::pos_to_str(move.set[PIECE_TO]);
 				Hexbitboard::set_black_knight(move.set[PIECE_TO]); // restore captured knight
+				Hexbitboard::hash_man(BLACK_KNIGHT, move.set[PIECE_TO]);
+				Eval::add_man(BLACK_KNIGHT, move.set[PIECE_TO]);
 			}
 			Hexbitboard::set_black();
 			//cout << endl;
@@ -233,10 +412,16 @@ void MoveGen::unmake_move()
 		switch (move.set[COLOR_PIECE] & 0xFCU) { // unset color bits
 		case KING:
 			Hexbitboard::set_black_king(move.set[PIECE_FROM]); // restore king position
+			Hexbitboard::hash_man(BLACK_KING, move.set[PIECE_TO]);
+			Hexbitboard::hash_man(BLACK_KING, move.set[PIECE_FROM]);
+			Eval::move_man(BLACK_KING, move.set[PIECE_TO], move.set[PIECE_FROM]);
 			break;
 		case KNIGHT:
 			Hexbitboard::unset_black_knight(move.set[PIECE_TO]);
 			Hexbitboard::set_black_knight(move.set[PIECE_FROM]); // restore knight position
+			Hexbitboard::hash_man(BLACK_KNIGHT, move.set[PIECE_TO]);
+			Hexbitboard::hash_man(BLACK_KNIGHT, move.set[PIECE_FROM]);
+			Eval::move_man(BLACK_KNIGHT, move.set[PIECE_TO], move.set[PIECE_FROM]);
 			break;
 		default:
 			assert(false);
@@ -246,9 +431,51 @@ void MoveGen::unmake_move()
 		if (move.set[MOVE_TYPE] & CAPTURING) {
 			if (move.set[MOVE_TYPE] & GET_KNIGHT) {
 				Hexbitboard::set_white_knight(move.set[PIECE_TO]); // restore captured knight
+				Hexbitboard::hash_man(WHITE_KNIGHT, move.set[PIECE_TO]);
+				Eval::add_man(WHITE_KNIGHT, move.set[PIECE_TO]);
 			}
 			Hexbitboard::set_white();
 		}
 	}
 	white_to_move = !white_to_move;
+	Hexbitboard::hash_side();
+	assert(Hexbitboard::get_key() == Hexbitboard::compute_key());
+	assert(Eval::state_is_ok());
+}
+
+// passes the move to the opponent, used by null move pruning
+// the null move is kept on the game stack so that repetitions are not looked for across it
+void MoveGen::make_null_move()
+{
+	assert(game_top < int(GAME_STACK_SIZE));
+	white_to_move = !white_to_move;
+	Hexbitboard::hash_side();
+	game_stack[game_top++].move = 0;
+	key_stack[game_top] = Hexbitboard::get_key();
+	halfmove_stack[game_top] = 0;
+}
+
+void MoveGen::unmake_null_move()
+{
+	game_top--;
+	white_to_move = !white_to_move;
+	Hexbitboard::hash_side();
+}
+
+uint64_t MoveGen::perft(const uint32_t depth)
+{
+	if (depth == 0) {
+		return 1;
+	}
+	uint64_t nodes = 0;
+	uint64_t bottom = open_ply();
+	Attacks::generate_moves();
+	for (uint64_t i = move_bottom; i < move_top; ++i) {
+		if (make_move(move_stack[i])) {
+			nodes += perft(depth - 1);
+		}
+		unmake_move();
+	}
+	close_ply(bottom);
+	return nodes;
 }
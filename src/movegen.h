@@ -27,9 +27,11 @@
 
 #include <inttypes.h>
 #include <string>
+#include <vector>
 
 const uint64_t MOVE_STACK_SIZE = 8192;
 const uint64_t GAME_STACK_SIZE = 1024;
+const uint32_t FIFTY_MOVES_PLIES = 100;
 
 enum piece { KING = 4, KNIGHT = 8, ROOK = 16, BISHOP = 32, QUEEN = 64, PAWN = 128 };
 
@@ -51,19 +53,43 @@ class MoveGen
 public:
 	static void add_move(const color_to_move c, const piece p, const uint8_t from, const uint8_t to);
 	static void reset_move_stack();
+	static void reset_game_stack();
+	static std::vector<uint64_t> get_history();
+	static void set_history(const std::vector<uint64_t> &keys);
+	static bool is_repetition(const int count);
+	static uint32_t get_halfmove_clock() { return halfmove_stack[game_top]; }
+	static bool is_fifty_moves() { return halfmove_stack[game_top] >= FIFTY_MOVES_PLIES; }
+	static uint64_t open_ply();
+	static void close_ply(const uint64_t bottom);
+	static void clear_ply() { move_top = move_bottom; }
+	static uint64_t get_move_bottom() { return move_bottom; }
+	static uint64_t get_move_top() { return move_top; }
+	static move_t get_move(const uint64_t i) { return move_stack[i]; }
+	static int32_t get_score(const uint64_t i) { return score_stack[i]; }
+	static void set_score(const uint64_t i, const int32_t score) { score_stack[i] = score; }
+	static move_t pick_move(const uint64_t i);
+	static std::string move_to_str(const move_t move);
+	static bool parse_move(const std::string text, move_t &move);
 	static std::string get_moves();
 	static std::string get_legal_moves();
+	static uint64_t remove_unlegal_moves();
+	static uint64_t keep_checks();
 	static bool make_move(move_t &move);
 	static void unmake_move();
-	static bool white_to_move;
+	static void make_null_move();
+	static void unmake_null_move();
+	static uint64_t perft(const uint32_t depth);
+	static thread_local bool white_to_move;
 private:
 	MoveGen();
-	static uint64_t remove_unlegal_moves();
-	static move_t move_stack[MOVE_STACK_SIZE];
-	static move_t game_stack[GAME_STACK_SIZE];
-	static uint64_t move_top;
-	static uint64_t move_bottom;
-	static int game_top;
+	static thread_local move_t move_stack[MOVE_STACK_SIZE];
+	static thread_local int32_t score_stack[MOVE_STACK_SIZE];
+	static thread_local move_t game_stack[GAME_STACK_SIZE];
+	static thread_local uint64_t key_stack[GAME_STACK_SIZE + 1];  // key after each move of the game stack
+	static thread_local uint32_t halfmove_stack[GAME_STACK_SIZE + 1];  // plies since the last capture
+	static thread_local uint64_t move_top;
+	static thread_local uint64_t move_bottom;
+	static thread_local int game_top;
 };
 
 #endif // MOVEGEN_H
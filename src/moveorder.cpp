@@ -0,0 +1,168 @@
+/*
+***************************************************************************
+**
+** Copyright (C) 2011 Zbigniew Sienkiewicz.
+** All rights reserved.
+**
+** Glaucus is Glinski's hexagonal chess engine.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+***************************************************************************
+*/
+
+#include "moveorder.h"
+#include "transtable.h"
+#include "eval.h"
+#include "see.h"
+
+thread_local move_t MoveOrder::killers[MAX_PLY][KILLER_SLOTS];
+thread_local move_t MoveOrder::counter_moves[HEXES_NUMBER_MAX][HEXES_NUMBER_MAX];
+thread_local int32_t MoveOrder::history[2][HEXES_NUMBER_MAX][HEXES_NUMBER_MAX];
+
+MoveOrder::MoveOrder()
+{
+}
+
+void MoveOrder::clear()
+{
+	for (int32_t ply = 0; ply < MAX_PLY; ++ply) {
+		for (uint32_t slot = 0; slot < KILLER_SLOTS; ++slot) {
+			killers[ply][slot].move = 0;
+		}
+	}
+	for (uint32_t from = 0; from < HEXES_NUMBER_MAX; ++from) {
+		for (uint32_t to = 0; to < HEXES_NUMBER_MAX; ++to) {
+			counter_moves[from][to].move = 0;
+			history[0][from][to] = 0;
+			history[1][from][to] = 0;
+		}
+	}
+}
+
+// killers belong to the previous search, history is only faded
+void MoveOrder::new_search()
+{
+	for (int32_t ply = 0; ply < MAX_PLY; ++ply) {
+		for (uint32_t slot = 0; slot < KILLER_SLOTS; ++slot) {
+			killers[ply][slot].move = 0;
+		}
+	}
+	for (uint32_t from = 0; from < HEXES_NUMBER_MAX; ++from) {
+		for (uint32_t to = 0; to < HEXES_NUMBER_MAX; ++to) {
+			history[0][from][to] /= 2;
+			history[1][from][to] /= 2;
+		}
+	}
+}
+
+bool MoveOrder::is_capture(const move_t move)
+{
+	if (move.set[COLOR_PIECE] & WHITE) {
+		return Hexbitboard::is_set_black(move.set[PIECE_TO]);
+	}
+	return Hexbitboard::is_set_white(move.set[PIECE_TO]);
+}
+
+int32_t MoveOrder::victim_value(const move_t move)
+{
+	const uint8_t to = move.set[PIECE_TO];
+	if (Hexbitboard::is_set_white_knight(to) || Hexbitboard::is_set_black_knight(to)) {
+		return KNIGHT_VALUE;
+	}
+	return 0;
+}
+
+/**
+ * most valuable victim first, then least valuable attacker; the king is
+ * the most valuable attacker as it can never be given for the victim
+ */
+int32_t MoveOrder::mvv_lva(const move_t move)
+{
+	int32_t victim = victim_value(move);
+	int32_t attacker;
+	switch (move.set[COLOR_PIECE] & 0xFCU) {  // unset color bits
+	case KNIGHT:
+		attacker = 1;
+		break;
+	default:
+		attacker = 7;
+		break;
+	}
+	return victim * 8 - attacker;
+}
+
+/**
+ * scores the moves of the current list, MoveGen::pick_move then hands
+ * them out best first
+ */
+void MoveOrder::score_moves(const uint16_t hash_move, const int32_t ply, const move_t previous)
+{
+	const move_t counter = counter_moves[previous.set[PIECE_FROM]][previous.set[PIECE_TO]];
+	for (uint64_t i = MoveGen::get_move_bottom(); i < MoveGen::get_move_top(); ++i) {
+		const move_t move = MoveGen::get_move(i);
+		int32_t score;
+		if (hash_move && TransTable::pack_move(move) == hash_move) {
+			score = HASH_MOVE_SCORE;
+		}
+		else if (is_capture(move)) {
+			score = (See::see_ge(move, 0) ? CAPTURE_SCORE : BAD_CAPTURE_SCORE) + mvv_lva(move);
+		}
+		else if (same_move(move, killers[ply][0])) {
+			score = KILLER_SCORE;
+		}
+		else if (same_move(move, killers[ply][1])) {
+			score = KILLER_SCORE - 1;
+		}
+		else if (previous.move && same_move(move, counter)) {
+			score = COUNTER_SCORE;
+		}
+		else {
+			score = history[color_index(move)][move.set[PIECE_FROM]][move.set[PIECE_TO]];
+		}
+		MoveGen::set_score(i, score);
+	}
+}
+
+// gravity update, keeps history within +-HISTORY_MAX without rescaling;
+// the product of entry and bonus needs 64 bits at deep searches
+void MoveOrder::add_history(const move_t move, const int32_t bonus)
+{
+	int32_t &entry = history[color_index(move)][move.set[PIECE_FROM]][move.set[PIECE_TO]];
+	entry += bonus - int32_t(int64_t(entry) * (bonus < 0 ? -bonus : bonus) / HISTORY_MAX);
+}
+
+/**
+ * called on a beta cutoff by a quiet move: the move becomes a killer and
+ * the counter move to previous, gets a history bonus and the quiet moves
+ * tried before it get a malus
+ */
+void MoveOrder::update(const move_t best, const int32_t depth, const int32_t ply, const move_t previous,
+					   const move_t *quiets, const uint32_t quiets_number)
+{
+	if (!same_move(best, killers[ply][0])) {
+		killers[ply][1] = killers[ply][0];
+		killers[ply][0] = best;
+	}
+	if (previous.move) {
+		counter_moves[previous.set[PIECE_FROM]][previous.set[PIECE_TO]] = best;
+	}
+	int32_t bonus = depth * depth;
+	add_history(best, bonus);
+	for (uint32_t i = 0; i < quiets_number; ++i) {
+		if (!same_move(quiets[i], best)) {
+			add_history(quiets[i], -bonus);
+		}
+	}
+}
@@ -0,0 +1,71 @@
+/*
+***************************************************************************
+**
+** Copyright (C) 2011 Zbigniew Sienkiewicz.
+** All rights reserved.
+**
+** Glaucus is Glinski's hexagonal chess engine.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+***************************************************************************
+*/
+
+#ifndef MOVEORDER_H
+#define MOVEORDER_H
+
+#include <inttypes.h>
+#include "hexbitboard.h"
+#include "movegen.h"
+#include "search.h"
+
+const int32_t HASH_MOVE_SCORE = 1 << 30;
+const int32_t CAPTURE_SCORE = 1 << 28;
+const int32_t KILLER_SCORE = 1 << 27;  // first killer, the second one gets one less
+const int32_t COUNTER_SCORE = (1 << 27) - 2;
+const int32_t BAD_CAPTURE_SCORE = -(1 << 28);  // captures losing material by SEE go last
+const int32_t HISTORY_MAX = 1 << 20;
+const uint32_t KILLER_SLOTS = 2;
+
+/**
+ * Scores generated moves for incremental selection: hash move, captures
+ * by MVV-LVA, two killers per ply, counter move to the previous move and
+ * a butterfly history of quiet moves that caused cutoffs. Captures losing
+ * material by static exchange are put behind all quiet moves.
+ */
+class MoveOrder
+{
+public:
+	static void clear();
+	static void new_search();
+	static void score_moves(const uint16_t hash_move, const int32_t ply, const move_t previous);
+	static void update(const move_t best, const int32_t depth, const int32_t ply, const move_t previous,
+					   const move_t *quiets, const uint32_t quiets_number);
+	static bool is_capture(const move_t move);
+	static int32_t victim_value(const move_t move);
+	static bool same_move(const move_t a, const move_t b)
+	{
+		return a.set[PIECE_FROM] == b.set[PIECE_FROM] && a.set[PIECE_TO] == b.set[PIECE_TO];
+	}
+private:
+	MoveOrder();
+	static int32_t mvv_lva(const move_t move);
+	static void add_history(const move_t move, const int32_t bonus);
+	static uint32_t color_index(const move_t move) { return (move.set[COLOR_PIECE] & WHITE) ? 0 : 1; }
+	static thread_local move_t killers[MAX_PLY][KILLER_SLOTS];
+	static thread_local move_t counter_moves[HEXES_NUMBER_MAX][HEXES_NUMBER_MAX];
+	static thread_local int32_t history[2][HEXES_NUMBER_MAX][HEXES_NUMBER_MAX];
+};
+
+#endif // MOVEORDER_H
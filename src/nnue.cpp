@@ -0,0 +1,566 @@
+/*
+***************************************************************************
+**
+** Copyright (C) 2011 Zbigniew Sienkiewicz.
+** All rights reserved.
+**
+** Glaucus is Glinski's hexagonal chess engine.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+***************************************************************************
+*/
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include "nnue.h"
+#include "hexbitboard.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NNUE_X86
+#include <immintrin.h>
+#endif
+
+uint8_t Nnue::cell[2][HEXES_NUMBER_MAX];
+bool Nnue::active = false;
+bool Nnue::loaded = false;
+std::string Nnue::file;
+nnue_kernel Nnue::kernel = KERNEL_SCALAR;
+int32_t Nnue::output_scale = 1;
+std::vector<int16_t> Nnue::ft_weights;
+int16_t Nnue::ft_biases[NNUE_HIDDEN];
+int8_t Nnue::l1_weights[NNUE_L2][2 * NNUE_HIDDEN];
+int32_t Nnue::l1_biases[NNUE_L2];
+int8_t Nnue::l2_weights[NNUE_L3][NNUE_L2];
+int32_t Nnue::l2_biases[NNUE_L3];
+int8_t Nnue::out_weights[NNUE_L3];
+int32_t Nnue::out_bias = 0;
+thread_local nnue_accumulator Nnue::stack[NNUE_STACK_SIZE];
+thread_local uint32_t Nnue::top = 0;
+thread_local bool Nnue::stale = false;
+
+static const char *KERNEL_NAMES[] = { "scalar", "sse2", "avx2", "avx512" };
+static const uint8_t NO_CELL = 0xFFU;
+
+/*
+ * kernels: a column of the first layer added to or taken from one side
+ * of the accumulator, and a dense int8 layer over uint8 inputs; inputs
+ * come in multiples of 32
+ */
+typedef void (*column_kernel)(int16_t *accumulator, const int16_t *column);
+typedef void (*affine_kernel)(const uint8_t *input, const int8_t *weights, const int32_t *biases,
+							  int32_t *output, const uint32_t inputs, const uint32_t outputs);
+
+static void add_column_scalar(int16_t *accumulator, const int16_t *column)
+{
+	for (uint32_t i = 0; i < NNUE_HIDDEN; ++i) {
+		accumulator[i] = int16_t(accumulator[i] + column[i]);
+	}
+}
+
+static void sub_column_scalar(int16_t *accumulator, const int16_t *column)
+{
+	for (uint32_t i = 0; i < NNUE_HIDDEN; ++i) {
+		accumulator[i] = int16_t(accumulator[i] - column[i]);
+	}
+}
+
+static void affine_scalar(const uint8_t *input, const int8_t *weights, const int32_t *biases,
+						  int32_t *output, const uint32_t inputs, const uint32_t outputs)
+{
+	for (uint32_t o = 0; o < outputs; ++o) {
+		int32_t sum = biases[o];
+		for (uint32_t i = 0; i < inputs; ++i) {
+			sum += int32_t(input[i]) * weights[o * inputs + i];
+		}
+		output[o] = sum;
+	}
+}
+
+#ifdef NNUE_X86
+
+__attribute__((target("sse2")))
+static void add_column_sse2(int16_t *accumulator, const int16_t *column)
+{
+	for (uint32_t i = 0; i < NNUE_HIDDEN; i += 8) {
+		__m128i *target = reinterpret_cast<__m128i *>(accumulator + i);
+		const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(column + i));
+		_mm_store_si128(target, _mm_add_epi16(_mm_load_si128(target), value));
+	}
+}
+
+__attribute__((target("sse2")))
+static void sub_column_sse2(int16_t *accumulator, const int16_t *column)
+{
+	for (uint32_t i = 0; i < NNUE_HIDDEN; i += 8) {
+		__m128i *target = reinterpret_cast<__m128i *>(accumulator + i);
+		const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(column + i));
+		_mm_store_si128(target, _mm_sub_epi16(_mm_load_si128(target), value));
+	}
+}
+
+// sse2 has no unsigned by signed byte product, both sides are widened to 16 bits
+__attribute__((target("sse2")))
+static void affine_sse2(const uint8_t *input, const int8_t *weights, const int32_t *biases,
+						int32_t *output, const uint32_t inputs, const uint32_t outputs)
+{
+	const __m128i zero = _mm_setzero_si128();
+	for (uint32_t o = 0; o < outputs; ++o) {
+		const int8_t *row = weights + o * inputs;
+		__m128i sum = zero;
+		for (uint32_t i = 0; i < inputs; i += 16) {
+			const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input + i));
+			const __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + i));
+			const __m128i sign = _mm_cmpgt_epi8(zero, w);
+			sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpacklo_epi8(in, zero), _mm_unpacklo_epi8(w, sign)));
+			sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpackhi_epi8(in, zero), _mm_unpackhi_epi8(w, sign)));
+		}
+		sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+		sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+		output[o] = biases[o] + _mm_cvtsi128_si32(sum);
+	}
+}
+
+__attribute__((target("avx2")))
+static void add_column_avx2(int16_t *accumulator, const int16_t *column)
+{
+	for (uint32_t i = 0; i < NNUE_HIDDEN; i += 16) {
+		__m256i *target = reinterpret_cast<__m256i *>(accumulator + i);
+		const __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(column + i));
+		_mm256_store_si256(target, _mm256_add_epi16(_mm256_load_si256(target), value));
+	}
+}
+
+__attribute__((target("avx2")))
+static void sub_column_avx2(int16_t *accumulator, const int16_t *column)
+{
+	for (uint32_t i = 0; i < NNUE_HIDDEN; i += 16) {
+		__m256i *target = reinterpret_cast<__m256i *>(accumulator + i);
+		const __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(column + i));
+		_mm256_store_si256(target, _mm256_sub_epi16(_mm256_load_si256(target), value));
+	}
+}
+
+__attribute__((target("avx2")))
+static int32_t sum_avx2(const __m256i sum)
+{
+	__m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+	half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+	half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+	return _mm_cvtsi128_si32(half);
+}
+
+// a pair of products cannot saturate: the inputs are clipped to 127
+__attribute__((target("avx2")))
+static void affine_avx2(const uint8_t *input, const int8_t *weights, const int32_t *biases,
+						int32_t *output, const uint32_t inputs, const uint32_t outputs)
+{
+	const __m256i ones = _mm256_set1_epi16(1);
+	for (uint32_t o = 0; o < outputs; ++o) {
+		const int8_t *row = weights + o * inputs;
+		__m256i sum = _mm256_setzero_si256();
+		for (uint32_t i = 0; i < inputs; i += 32) {
+			const __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input + i));
+			const __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row + i));
+			sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(in, w), ones));
+		}
+		output[o] = biases[o] + sum_avx2(sum);
+	}
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void add_column_avx512(int16_t *accumulator, const int16_t *column)
+{
+	for (uint32_t i = 0; i < NNUE_HIDDEN; i += 32) {
+		const __m512i value = _mm512_loadu_si512(column + i);
+		_mm512_store_si512(accumulator + i, _mm512_add_epi16(_mm512_load_si512(accumulator + i), value));
+	}
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void sub_column_avx512(int16_t *accumulator, const int16_t *column)
+{
+	for (uint32_t i = 0; i < NNUE_HIDDEN; i += 32) {
+		const __m512i value = _mm512_loadu_si512(column + i);
+		_mm512_store_si512(accumulator + i, _mm512_sub_epi16(_mm512_load_si512(accumulator + i), value));
+	}
+}
+
+// layers of 32 inputs take the avx2 path
+__attribute__((target("avx512f,avx512bw,avx2")))
+static void affine_avx512(const uint8_t *input, const int8_t *weights, const int32_t *biases,
+						  int32_t *output, const uint32_t inputs, const uint32_t outputs)
+{
+	if (inputs % 64) {
+		affine_avx2(input, weights, biases, output, inputs, outputs);
+		return;
+	}
+	const __m512i ones = _mm512_set1_epi16(1);
+	for (uint32_t o = 0; o < outputs; ++o) {
+		const int8_t *row = weights + o * inputs;
+		__m512i sum = _mm512_setzero_si512();
+		for (uint32_t i = 0; i < inputs; i += 64) {
+			const __m512i in = _mm512_loadu_si512(input + i);
+			const __m512i w = _mm512_loadu_si512(row + i);
+			sum = _mm512_add_epi32(sum, _mm512_madd_epi16(_mm512_maddubs_epi16(in, w), ones));
+		}
+		// the shuffles of gcc 12 warn about their undefined operand, the lanes are added in memory
+		alignas(64) int32_t lanes[16];
+		_mm512_store_si512(lanes, sum);
+		int32_t total = biases[o];
+		for (uint32_t lane = 0; lane < 16; ++lane) {
+			total += lanes[lane];
+		}
+		output[o] = total;
+	}
+}
+
+#endif // NNUE_X86
+
+static column_kernel add_column = add_column_scalar;
+static column_kernel sub_column = sub_column_scalar;
+static affine_kernel affine = affine_scalar;
+
+Nnue::Nnue()
+{
+}
+
+/**
+ * numbers the hexes file by file from a1, for black the board is
+ * flipped so that each file is read from its far end, and picks the
+ * best kernel the CPU supports
+ */
+void Nnue::init()
+{
+	std::memset(cell, NO_CELL, sizeof(cell));
+	uint8_t index = 0;
+	for (uint32_t file = FILE_A; file <= FILE_L; ++file) {
+		const uint32_t length = 6 + (file < FILE_F ? file : FILE_L - file);
+		for (uint32_t rank = 0; rank < length; ++rank) {
+			cell[0][10 + file + 11 * rank] = index;
+			cell[1][10 + file + 11 * (length - 1 - rank)] = index;
+			index++;
+		}
+	}
+	assert(index == NNUE_CELLS);
+	for (int32_t k = KERNEL_AVX512; k >= KERNEL_SCALAR; --k) {
+		if (kernel_supported(nnue_kernel(k))) {
+			set_kernel(KERNEL_NAMES[k]);
+			break;
+		}
+	}
+}
+
+bool Nnue::kernel_supported(const nnue_kernel candidate)
+{
+#ifdef NNUE_X86
+	switch (candidate) {
+	case KERNEL_AVX512:
+		return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx2");
+	case KERNEL_AVX2:
+		return __builtin_cpu_supports("avx2");
+	case KERNEL_SSE2:
+		return __builtin_cpu_supports("sse2");
+	default:
+		return true;
+	}
+#else
+	return candidate == KERNEL_SCALAR;
+#endif
+}
+
+bool Nnue::set_kernel(const std::string name)
+{
+	for (uint32_t k = KERNEL_SCALAR; k <= KERNEL_AVX512; ++k) {
+		if (name != KERNEL_NAMES[k]) {
+			continue;
+		}
+		if (!kernel_supported(nnue_kernel(k))) {
+			return false;
+		}
+		kernel = nnue_kernel(k);
+		switch (kernel) {
+#ifdef NNUE_X86
+		case KERNEL_AVX512:
+			add_column = add_column_avx512;
+			sub_column = sub_column_avx512;
+			affine = affine_avx512;
+			break;
+		case KERNEL_AVX2:
+			add_column = add_column_avx2;
+			sub_column = sub_column_avx2;
+			affine = affine_avx2;
+			break;
+		case KERNEL_SSE2:
+			add_column = add_column_sse2;
+			sub_column = sub_column_sse2;
+			affine = affine_sse2;
+			break;
+#endif
+		default:
+			add_column = add_column_scalar;
+			sub_column = sub_column_scalar;
+			affine = affine_scalar;
+		}
+		return true;
+	}
+	return false;
+}
+
+std::string Nnue::get_kernel()
+{
+	return KERNEL_NAMES[kernel];
+}
+
+std::string Nnue::get_kernels()
+{
+	std::string names;
+	for (uint32_t k = KERNEL_SCALAR; k <= KERNEL_AVX512; ++k) {
+		if (kernel_supported(nnue_kernel(k))) {
+			names += names.empty() ? KERNEL_NAMES[k] : std::string(" ") + KERNEL_NAMES[k];
+		}
+	}
+	return names;
+}
+
+static uint64_t get_bytes(const char *buffer, const uint32_t bytes)
+{
+	uint64_t value = 0;
+	for (uint32_t i = bytes; i > 0; --i) {
+		value = (value << 8) | uint8_t(buffer[i - 1]);
+	}
+	return value;
+}
+
+/**
+ * reads a network: "GLAUCUSN", version, the four layer sizes and the
+ * output scale as 32-bit words, then biases and weights of each layer,
+ * all little endian; the sizes must match the ones compiled in
+ */
+bool Nnue::load(const std::string file_name, std::string &error)
+{
+	std::ifstream input(file_name, std::ios::binary | std::ios::ate);
+	if (!input) {
+		error = "cannot read " + file_name;
+		return false;
+	}
+	std::vector<char> buffer(static_cast<size_t>(input.tellg()));
+	input.seekg(0);
+	const size_t header = 8 + 6 * 4;
+	const size_t size = header + 2 * (NNUE_HIDDEN + size_t(NNUE_FEATURES) * NNUE_HIDDEN)
+			+ 4 * NNUE_L2 + NNUE_L2 * 2 * NNUE_HIDDEN + 4 * NNUE_L3 + NNUE_L3 * NNUE_L2 + 4 + NNUE_L3;
+	if (buffer.size() < header || !input.read(buffer.data(), std::streamsize(buffer.size()))
+			|| std::memcmp(buffer.data(), "GLAUCUSN", 8) != 0) {
+		error = file_name + " is not a network";
+		return false;
+	}
+	if (get_bytes(&buffer[8], 4) != NNUE_FILE_VERSION) {
+		error = "unsupported network version " + std::to_string(get_bytes(&buffer[8], 4));
+		return false;
+	}
+	if (get_bytes(&buffer[12], 4) != NNUE_FEATURES || get_bytes(&buffer[16], 4) != NNUE_HIDDEN
+			|| get_bytes(&buffer[20], 4) != NNUE_L2 || get_bytes(&buffer[24], 4) != NNUE_L3 || buffer.size() != size) {
+		error = "network layers do not match " + std::to_string(NNUE_FEATURES) + "x" + std::to_string(NNUE_HIDDEN)
+				+ "x2-" + std::to_string(NNUE_L2) + "-" + std::to_string(NNUE_L3) + "-1";
+		return false;
+	}
+	output_scale = int32_t(get_bytes(&buffer[28], 4));
+	if (output_scale <= 0) {
+		error = "bad output scale";
+		return false;
+	}
+	const char *data = &buffer[header];
+	for (uint32_t i = 0; i < NNUE_HIDDEN; ++i, data += 2) {
+		ft_biases[i] = int16_t(get_bytes(data, 2));
+	}
+	ft_weights.resize(size_t(NNUE_FEATURES) * NNUE_HIDDEN);
+	for (size_t i = 0; i < ft_weights.size(); ++i, data += 2) {
+		ft_weights[i] = int16_t(get_bytes(data, 2));
+	}
+	for (uint32_t i = 0; i < NNUE_L2; ++i, data += 4) {
+		l1_biases[i] = int32_t(get_bytes(data, 4));
+	}
+	std::memcpy(l1_weights, data, sizeof(l1_weights));
+	data += sizeof(l1_weights);
+	for (uint32_t i = 0; i < NNUE_L3; ++i, data += 4) {
+		l2_biases[i] = int32_t(get_bytes(data, 4));
+	}
+	std::memcpy(l2_weights, data, sizeof(l2_weights));
+	data += sizeof(l2_weights);
+	out_bias = int32_t(get_bytes(data, 4));
+	std::memcpy(out_weights, data + 4, sizeof(out_weights));
+	loaded = true;
+	active = true;
+	file = file_name;
+	refresh();
+	return true;
+}
+
+bool Nnue::set_active(const bool on)
+{
+	if (on && !loaded) {
+		return false;
+	}
+	active = on;
+	if (active) {
+		refresh();
+	}
+	return true;
+}
+
+uint32_t Nnue::man_type(const uint32_t side, const uint8_t man_color, const uint8_t man_piece)
+{
+	const bool own = ((man_color & WHITE) != 0) == (side == 0);
+	if (man_piece == KNIGHT) {
+		return own ? 0 : 1;
+	}
+	return own ? NNUE_MAN_TYPES : 2;  // the own king is no feature
+}
+
+uint32_t Nnue::feature(const uint32_t side, const uint32_t king_cell, const uint32_t type, const uint8_t position)
+{
+	assert(cell[side][position] != NO_CELL);
+	return (king_cell * NNUE_MAN_TYPES + type) * NNUE_CELLS + cell[side][position];
+}
+
+// sums the columns of all men for one side from the biases
+void Nnue::refresh_side(nnue_accumulator &accumulator, const uint32_t side)
+{
+	int16_t *values = accumulator.side[side];
+	bits128 own_king = side == 0 ? Hexbitboard::get_white_king() : Hexbitboard::get_black_king();
+	const uint32_t king_cell = cell[side][Hexbitboard::get_lsb(own_king)];
+	std::memcpy(values, ft_biases, sizeof(ft_biases));
+	const uint8_t colors[] = { WHITE, WHITE, BLACK, BLACK };
+	const uint8_t pieces[] = { KING, KNIGHT, KING, KNIGHT };
+	const bits128 boards[] = { Hexbitboard::get_white_king(), Hexbitboard::get_white_knight(),
+							   Hexbitboard::get_black_king(), Hexbitboard::get_black_knight() };
+	for (uint32_t i = 0; i < 4; ++i) {
+		const uint32_t type = man_type(side, colors[i], pieces[i]);
+		if (type == NNUE_MAN_TYPES) {
+			continue;
+		}
+		bits128 men = boards[i];
+		while (men) {
+			const uint8_t position = Hexbitboard::get_lsb_and_reset(men);
+			add_column(values, &ft_weights[size_t(feature(side, king_cell, type, position)) * NNUE_HIDDEN]);
+		}
+	}
+}
+
+// starts the stack from the board, after the position was set up
+void Nnue::refresh()
+{
+	if (!active) {
+		return;
+	}
+	top = 0;
+	stale = false;
+	refresh_side(stack[0], 0);
+	refresh_side(stack[0], 1);
+}
+
+/**
+ * the move is already made on the board: a side whose king moved is
+ * refreshed, the other gets the columns of the moved and captured men
+ */
+void Nnue::push(const move_t move)
+{
+	if (!active) {
+		return;
+	}
+	if (stale) {
+		refresh();
+		return;
+	}
+	// a long game: the older half is dropped, unmaking into it refreshes
+	if (top + 1 == NNUE_STACK_SIZE) {
+		std::memmove(stack, stack + NNUE_STACK_SIZE / 2, sizeof(nnue_accumulator) * (NNUE_STACK_SIZE / 2));
+		top -= NNUE_STACK_SIZE / 2;
+	}
+	nnue_accumulator &next = stack[top + 1];
+	next = stack[top];
+	top++;
+	const uint8_t color = move.set[COLOR_PIECE] & (WHITE | BLACK);
+	const uint8_t piece = move.set[COLOR_PIECE] & 0xFCU;
+	const uint8_t enemy = color ^ (WHITE | BLACK);
+	for (uint32_t side = 0; side < 2; ++side) {
+		const uint32_t type = man_type(side, color, piece);
+		if (type == NNUE_MAN_TYPES) {
+			refresh_side(next, side);
+			continue;
+		}
+		bits128 own_king = side == 0 ? Hexbitboard::get_white_king() : Hexbitboard::get_black_king();
+		const uint32_t king_cell = cell[side][Hexbitboard::get_lsb(own_king)];
+		int16_t *values = next.side[side];
+		sub_column(values, &ft_weights[size_t(feature(side, king_cell, type, move.set[PIECE_FROM])) * NNUE_HIDDEN]);
+		add_column(values, &ft_weights[size_t(feature(side, king_cell, type, move.set[PIECE_TO])) * NNUE_HIDDEN]);
+		if (move.set[MOVE_TYPE] & GET_KNIGHT) {
+			const uint32_t captured = man_type(side, enemy, KNIGHT);
+			sub_column(values, &ft_weights[size_t(feature(side, king_cell, captured, move.set[PIECE_TO])) * NNUE_HIDDEN]);
+		}
+	}
+}
+
+bool Nnue::accumulator_is_ok()
+{
+	if (!active || stale) {
+		return true;
+	}
+	nnue_accumulator full;
+	refresh_side(full, 0);
+	refresh_side(full, 1);
+	return std::memcmp(&full, &stack[top], sizeof(full)) == 0;
+}
+
+static void clip(const int32_t *input, uint8_t *output, const uint32_t size)
+{
+	for (uint32_t i = 0; i < size; ++i) {
+		const int32_t value = input[i] >> NNUE_WEIGHT_SHIFT;
+		output[i] = uint8_t(value < 0 ? 0 : (value > NNUE_CLIP ? NNUE_CLIP : value));
+	}
+}
+
+/**
+ * runs the layers above the accumulator, the side to move first
+ * @return score from the side to move point of view
+ */
+int32_t Nnue::evaluate(const bool white)
+{
+	if (stale) {
+		refresh();
+	}
+	assert(accumulator_is_ok());
+	alignas(64) uint8_t input[2 * NNUE_HIDDEN];
+	alignas(64) int32_t hidden1[NNUE_L2];
+	alignas(64) uint8_t input2[NNUE_L2];
+	alignas(64) int32_t hidden2[NNUE_L3];
+	alignas(64) uint8_t input3[NNUE_L3];
+	const nnue_accumulator &accumulator = stack[top];
+	const int16_t *halves[2] = { accumulator.side[white ? 0 : 1], accumulator.side[white ? 1 : 0] };
+	for (uint32_t half = 0; half < 2; ++half) {
+		for (uint32_t i = 0; i < NNUE_HIDDEN; ++i) {
+			const int16_t value = halves[half][i];
+			input[half * NNUE_HIDDEN + i] = uint8_t(value < 0 ? 0 : (value > NNUE_CLIP ? NNUE_CLIP : value));
+		}
+	}
+	affine(input, &l1_weights[0][0], l1_biases, hidden1, 2 * NNUE_HIDDEN, NNUE_L2);
+	clip(hidden1, input2, NNUE_L2);
+	affine(input2, &l2_weights[0][0], l2_biases, hidden2, NNUE_L2, NNUE_L3);
+	clip(hidden2, input3, NNUE_L3);
+	int32_t output = out_bias;
+	for (uint32_t i = 0; i < NNUE_L3; ++i) {
+		output += int32_t(input3[i]) * out_weights[i];
+	}
+	return output / output_scale;
+}
@@ -0,0 +1,114 @@
+/*
+***************************************************************************
+**
+** Copyright (C) 2011 Zbigniew Sienkiewicz.
+** All rights reserved.
+**
+** Glaucus is Glinski's hexagonal chess engine.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+***************************************************************************
+*/
+#ifndef NNUE_H
+#define NNUE_H
+
+#include <inttypes.h>
+#include <string>
+#include <vector>
+#include "hexbitboard.h"
+#include "movegen.h"
+
+const uint32_t NNUE_FILE_VERSION = 1;
+const uint32_t NNUE_CELLS = 91;  // hexes of the board
+const uint32_t NNUE_MAN_TYPES = 3;  // own knight, enemy knight, enemy king
+const uint32_t NNUE_FEATURES = NNUE_CELLS * NNUE_MAN_TYPES * NNUE_CELLS;  // by own king hex, man, hex
+const uint32_t NNUE_HIDDEN = 128;  // accumulator of one side
+const uint32_t NNUE_L2 = 32;
+const uint32_t NNUE_L3 = 32;
+const int32_t NNUE_WEIGHT_SHIFT = 6;  // fixed point of the int8 layers
+const int32_t NNUE_CLIP = 127;
+const uint32_t NNUE_STACK_SIZE = 160;  // a search line of up to 64 plies fits above a shift by half
+
+// first layer output of both sides, white's and black's point of view
+struct alignas(64) nnue_accumulator {
+	int16_t side[2][NNUE_HIDDEN];
+};
+
+enum nnue_kernel { KERNEL_SCALAR, KERNEL_SSE2, KERNEL_AVX2, KERNEL_AVX512 };
+
+/**
+ * Efficiently updatable network: the features of each side are the man
+ * type and hex of every man but its own king, by the hex of that king,
+ * seen from the side (black's board is flipped). The accumulator is kept
+ * on a stack updated by make_move from the men that moved, only a king
+ * move refreshes its side; the stack holds a search line rather than the
+ * whole game, older entries are dropped and refreshed when needed; the small int8 layers run on SIMD kernels
+ * chosen for the CPU at start.
+ */
+class Nnue
+{
+public:
+	static void init();
+	static bool load(const std::string file_name, std::string &error);
+	static void unload() { active = false; }
+	static bool is_active() { return active; }
+	static bool is_loaded() { return loaded; }
+	static bool set_active(const bool on);
+	static void refresh();
+	static void push(const move_t move);
+	static void pop()
+	{
+		if (!active) {
+			return;
+		}
+		if (top) {
+			top--;
+		}
+		else {
+			stale = true;  // unmade below the oldest entry, the board is read again
+		}
+	}
+	static int32_t evaluate(const bool white);
+	static bool accumulator_is_ok();
+	static bool set_kernel(const std::string name);
+	static std::string get_kernel();
+	static std::string get_kernels();
+	static std::string get_file() { return file; }
+private:
+	Nnue();
+	static void refresh_side(nnue_accumulator &accumulator, const uint32_t side);
+	static uint32_t feature(const uint32_t side, const uint32_t king_cell, const uint32_t type, const uint8_t position);
+	static uint32_t man_type(const uint32_t side, const uint8_t man_color, const uint8_t man_piece);
+	static bool kernel_supported(const nnue_kernel kernel);
+	static uint8_t cell[2][HEXES_NUMBER_MAX];  // hex index 0..90 seen from white and black
+	static bool active;
+	static bool loaded;
+	static std::string file;
+	static nnue_kernel kernel;
+	static int32_t output_scale;
+	static std::vector<int16_t> ft_weights;  // NNUE_FEATURES columns of NNUE_HIDDEN
+	static int16_t ft_biases[NNUE_HIDDEN];
+	static int8_t l1_weights[NNUE_L2][2 * NNUE_HIDDEN];
+	static int32_t l1_biases[NNUE_L2];
+	static int8_t l2_weights[NNUE_L3][NNUE_L2];
+	static int32_t l2_biases[NNUE_L3];
+	static int8_t out_weights[NNUE_L3];
+	static int32_t out_bias;
+	static thread_local nnue_accumulator stack[NNUE_STACK_SIZE];
+	static thread_local uint32_t top;
+	static thread_local bool stale;
+};
+
+#endif // NNUE_H
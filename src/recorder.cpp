@@ -0,0 +1,118 @@
+/*
+***************************************************************************
+**
+** Copyright (C) 2011 Zbigniew Sienkiewicz.
+** All rights reserved.
+**
+** Glaucus is Glinski's hexagonal chess engine.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+***************************************************************************
+*/
+#ifdef TREE_RECORD
+
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include "recorder.h"
+
+thread_local FILE *Recorder::file = nullptr;
+thread_local tree_record Recorder::frames[RECORD_STACK];
+thread_local uint32_t Recorder::top = 0;
+thread_local tree_record Recorder::buffer[RECORD_BUFFER];
+thread_local uint32_t Recorder::used = 0;
+
+Recorder::Recorder()
+{
+}
+
+static int16_t clamp_score(const int32_t score)
+{
+	return int16_t(score < INT16_MIN ? INT16_MIN : (score > INT16_MAX ? INT16_MAX : score));
+}
+
+// starts the file of a search thread, the previous search is overwritten
+void Recorder::open(const uint32_t thread)
+{
+	const std::string name = "tree-" + std::to_string(thread) + ".bin";
+	file = std::fopen(name.c_str(), "wb");
+	if (!file) {
+		std::cout << "cannot write " << name << std::endl;
+		return;
+	}
+	record_header header;
+	std::memcpy(header.magic, RECORD_MAGIC, sizeof(header.magic));
+	header.version = RECORD_VERSION;
+	header.record_size = sizeof(tree_record);
+	header.thread = thread;
+	std::fwrite(&header, sizeof(header), 1, file);
+	used = 0;
+	top = 0;
+}
+
+void Recorder::close()
+{
+	if (file) {
+		flush();
+		std::fclose(file);
+		file = nullptr;
+	}
+}
+
+void Recorder::flush()
+{
+	std::fwrite(buffer, sizeof(tree_record), used, file);
+	used = 0;
+}
+
+/**
+ * opens a node; nodes left without leave() are those of a stopped search,
+ * which ends the recording of the thread
+ */
+void Recorder::enter(const int32_t ply, const int32_t depth, const int32_t alpha, const int32_t beta, const uint16_t move)
+{
+	assert(top < RECORD_STACK);
+	tree_record &frame = frames[top];
+	frame.level = uint16_t(top++);
+	frame.move = move;
+	frame.alpha = clamp_score(alpha);
+	frame.beta = clamp_score(beta);
+	frame.ply = uint8_t(ply);
+	frame.depth = int8_t(depth);
+	frame.cutoff = CUTOFF_NONE;
+}
+
+void Recorder::cutoff(const uint32_t index)
+{
+	frames[top - 1].cutoff = uint8_t(index < CUTOFF_NONE ? index : CUTOFF_NONE - 1);
+}
+
+void Recorder::leave(const int32_t score, const node_kind kind, const uint32_t searched)
+{
+	tree_record &frame = frames[--top];
+	if (!file) {
+		return;
+	}
+	frame.score = clamp_score(score);
+	frame.kind = uint8_t(kind);
+	frame.searched = uint16_t(searched);
+	buffer[used++] = frame;
+	if (used == RECORD_BUFFER) {
+		flush();
+	}
+}
+
+#endif // TREE_RECORD
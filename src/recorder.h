@@ -0,0 +1,106 @@
+/*
+***************************************************************************
+**
+** Copyright (C) 2011 Zbigniew Sienkiewicz.
+** All rights reserved.
+**
+** Glaucus is Glinski's hexagonal chess engine.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+***************************************************************************
+*/
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <inttypes.h>
+#include <cstdio>
+
+const char RECORD_MAGIC[4] = { 'G', 'T', 'R', 'E' };
+const uint32_t RECORD_VERSION = 1;
+const uint32_t RECORD_BUFFER = 8192;  // records written at once
+const uint32_t RECORD_STACK = 256;  // nodes open at once, a node may be searched again at its own ply
+const uint8_t CUTOFF_NONE = 0xFFU;
+
+enum node_kind { NODE_PV, NODE_CUT, NODE_ALL, NODE_QUIESCENCE, NODE_HASH, NODE_PRUNED, NODE_TERMINAL };
+
+/**
+ * one visited node, written when the search leaves it: children always
+ * come before their parent; the level gives the shape of the tree, it is
+ * the ply except that a node searched again at its own ply, such as a
+ * null move verification, is a child of the first search
+ */
+struct tree_record {
+	uint16_t move;  // packed as in the hash table, 0 at the root and after a null move
+	int16_t alpha;  // window on entry
+	int16_t beta;
+	int16_t score;
+	uint8_t ply;
+	int8_t depth;
+	uint8_t kind;
+	uint8_t cutoff;  // 1-based index of the move failing high, CUTOFF_NONE without a cutoff
+	uint16_t searched;  // moves searched
+	uint16_t level;
+};
+
+struct record_header {
+	char magic[4];
+	uint32_t version;
+	uint32_t record_size;
+	uint32_t thread;
+};
+
+#ifdef TREE_RECORD
+
+/**
+ * Tree recorder of the profiling build (qmake CONFIG+=record): every
+ * search thread writes the nodes it visits to its own file tree-N.bin
+ * through a buffer; tools/treestat reads the files. Other builds compile
+ * the RECORD_ macros to nothing.
+ */
+class Recorder
+{
+public:
+	static void open(const uint32_t thread);
+	static void close();
+	static void enter(const int32_t ply, const int32_t depth, const int32_t alpha, const int32_t beta, const uint16_t move);
+	static void cutoff(const uint32_t index);
+	static void leave(const int32_t score, const node_kind kind, const uint32_t searched);
+private:
+	Recorder();
+	static void flush();
+	static thread_local FILE *file;
+	static thread_local tree_record frames[RECORD_STACK];
+	static thread_local uint32_t top;
+	static thread_local tree_record buffer[RECORD_BUFFER];
+	static thread_local uint32_t used;
+};
+
+#define RECORD_OPEN(thread) Recorder::open(thread)
+#define RECORD_CLOSE() Recorder::close()
+#define RECORD_ENTER(ply, depth, alpha, beta, move) Recorder::enter(ply, depth, alpha, beta, move)
+#define RECORD_CUTOFF(index) Recorder::cutoff(index)
+#define RECORD_LEAVE(score, kind, searched) Recorder::leave(score, kind, searched)
+
+#else
+
+#define RECORD_OPEN(thread) ((void)0)
+#define RECORD_CLOSE() ((void)0)
+#define RECORD_ENTER(ply, depth, alpha, beta, move) ((void)0)
+#define RECORD_CUTOFF(index) ((void)0)
+#define RECORD_LEAVE(score, kind, searched) ((void)0)
+
+#endif // TREE_RECORD
+
+#endif // RECORDER_H
@@ -0,0 +1,961 @@
+/*
+***************************************************************************
+**
+** Copyright (C) 2011 Zbigniew Sienkiewicz.
+** All rights reserved.
+**
+** Glaucus is Glinski's hexagonal chess engine.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+***************************************************************************
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+#include "search.h"
+#include "attacks.h"
+#include "hexbitboard.h"
+#include "transtable.h"
+#include "eval.h"
+#include "moveorder.h"
+#include "see.h"
+#include "timeman.h"
+#include "stats.h"
+#include "recorder.h"
+
+using std::cout;
+using std::endl;
+
+search_limits Search::limits;
+search_options Search::options = { true, true, true, true, true, true, true, true, false, false };
+int32_t Search::lmr_table[MAX_PLY][MAX_PLY];
+std::chrono::steady_clock::time_point Search::start;
+uint32_t Search::threads = 1;
+uint32_t Search::multipv = 1;
+uint32_t Search::root_moves = 0;
+bool Search::verbose = true;
+std::atomic<bool> Search::stop(false);
+std::atomic<bool> Search::searching(false);
+uint64_t Search::slack = DEFAULT_SLACK;
+std::atomic<bool> Search::pondering(false);
+std::thread Search::background;
+move_t Search::background_move;
+move_t Search::ponder_move;
+thread_result Search::results[THREADS_MAX];
+// helper threads skip iterations in these patterns, so that they spread
+// over different depths and fill the shared hash for each other
+const int32_t Search::skip_size[SKIP_PATTERNS] = { 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4 };
+const int32_t Search::skip_phase[SKIP_PATTERNS] = { 0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7 };
+thread_local uint32_t Search::thread_id = 0;
+thread_local uint64_t Search::nodes = 0;
+thread_local uint64_t Search::qnodes = 0;
+thread_local uint64_t Search::next_check = CHECK_NODES;
+thread_local uint64_t Search::check_interval = CHECK_NODES;
+thread_local move_t Search::pv[MAX_PLY][MAX_PLY];
+thread_local move_t Search::current_move[MAX_PLY];
+thread_local int32_t Search::pv_length[MAX_PLY];
+thread_local uint32_t Search::pv_index = 0;
+thread_local root_line Search::lines[MULTIPV_MAX];
+
+Search::Search()
+{
+}
+
+void Search::init()
+{
+	for (int32_t depth = 1; depth < MAX_PLY; ++depth) {
+		for (int32_t moves = 1; moves < MAX_PLY; ++moves) {
+			lmr_table[depth][moves] = int32_t(0.5 + std::log(double(depth)) * std::log(double(moves)) / 2.25);
+		}
+	}
+	MoveOrder::clear();
+}
+
+bool Search::set_option(const std::string name, const bool value)
+{
+	if (name == "pvs") {
+		options.pvs = value;
+	}
+	else if (name == "aspiration") {
+		options.aspiration = value;
+	}
+	else if (name == "nullmove") {
+		options.null_move = value;
+	}
+	else if (name == "lmr") {
+		options.lmr = value;
+	}
+	else if (name == "futility") {
+		options.futility = value;
+	}
+	else if (name == "razoring") {
+		options.razoring = value;
+	}
+	else if (name == "delta") {
+		options.delta = value;
+	}
+	else if (name == "see") {
+		options.see = value;
+	}
+	else if (name == "pin") {
+		options.pin = value;
+	}
+	else if (name == "ponder") {
+		options.ponder = value;
+	}
+	else {
+		return false;
+	}
+	return true;
+}
+
+std::string Search::get_options()
+{
+	std::ostringstream text;
+	text << "pvs " << (options.pvs ? "on" : "off")
+		 << "\naspiration " << (options.aspiration ? "on" : "off")
+		 << "\nnullmove " << (options.null_move ? "on" : "off")
+		 << "\nlmr " << (options.lmr ? "on" : "off")
+		 << "\nfutility " << (options.futility ? "on" : "off")
+		 << "\nrazoring " << (options.razoring ? "on" : "off")
+		 << "\ndelta " << (options.delta ? "on" : "off")
+		 << "\nsee " << (options.see ? "on" : "off")
+		 << "\npin " << (options.pin ? "on" : "off")
+		 << "\nponder " << (options.ponder ? "on" : "off") << "\n";
+	return text.str();
+}
+
+uint64_t Search::elapsed()
+{
+	return uint64_t(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+uint64_t Search::elapsed_micro()
+{
+	return uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+bool Search::set_threads(const uint32_t number)
+{
+	if (number < 1 || number > THREADS_MAX) {
+		return false;
+	}
+	threads = number;
+	return true;
+}
+
+bool Search::set_multipv(const uint32_t number)
+{
+	if (number < 1 || number > MULTIPV_MAX) {
+		return false;
+	}
+	multipv = number;
+	return true;
+}
+
+// nodes of all threads, the helpers' counts lag by one check interval
+uint64_t Search::get_nodes()
+{
+	uint64_t total = 0;
+	for (uint32_t i = 0; i < threads; ++i) {
+		total += (i == thread_id) ? nodes : results[i].nodes.load(std::memory_order_relaxed);
+	}
+	return total;
+}
+
+uint64_t Search::get_qnodes()
+{
+	uint64_t total = 0;
+	for (uint32_t i = 0; i < threads; ++i) {
+		total += (i == thread_id) ? qnodes : results[i].qnodes.load(std::memory_order_relaxed);
+	}
+	return total;
+}
+
+/**
+ * publishes the node counts of the thread, only the main thread checks
+ * the limits and stops all of them; the clock is read often enough to
+ * stop within the slack, half of it at the speed measured so far
+ */
+void Search::check_limits()
+{
+	results[thread_id].nodes.store(nodes, std::memory_order_relaxed);
+	results[thread_id].qnodes.store(qnodes, std::memory_order_relaxed);
+	next_check = nodes + check_interval;
+	if (thread_id || pondering) {
+		return;
+	}
+	const uint64_t micro = elapsed_micro();
+	const uint64_t total = get_nodes();
+	if (limits.nodes && total >= limits.nodes) {
+		stop = true;
+	}
+	if (limits.time && micro >= limits.time * 1000) {
+		stop = true;
+	}
+	if (micro) {
+		check_interval = std::min(CHECK_NODES_MAX, std::max(CHECK_NODES_MIN, nodes * slack * 500 / micro));
+	}
+	if (limits.nodes && limits.nodes > total) {
+		check_interval = std::min(check_interval, limits.nodes - total);
+	}
+	next_check = nodes + check_interval;
+}
+
+// mate scores are stored relative to the node, not to the root
+int32_t Search::score_to_tt(const int32_t score, const int32_t ply)
+{
+	if (score > MATE_BOUND) {
+		return score + ply;
+	}
+	if (score < -MATE_BOUND) {
+		return score - ply;
+	}
+	return score;
+}
+
+int32_t Search::score_from_tt(const int32_t score, const int32_t ply)
+{
+	if (score > MATE_BOUND) {
+		return score - ply;
+	}
+	if (score < -MATE_BOUND) {
+		return score + ply;
+	}
+	return score;
+}
+
+std::string Search::score_to_str(const int32_t score)
+{
+	std::ostringstream text;
+	if (score > MATE_BOUND) {
+		text << "mate " << (MATE_SCORE - score + 1) / 2;
+	}
+	else if (score < -MATE_BOUND) {
+		text << "mate -" << (MATE_SCORE + score) / 2;
+	}
+	else {
+		text << score;
+	}
+	return text.str();
+}
+
+std::string Search::pv_to_str(const move_t *line, const int32_t length)
+{
+	std::string text;
+	for (int32_t i = 0; i < length; ++i) {
+		text += " " + MoveGen::move_to_str(line[i]);
+	}
+	return text;
+}
+
+/**
+ * principal variation search with null move pruning (verified near the
+ * root), late move reductions, futility pruning and razoring, each of
+ * which can be switched off by an option
+ */
+int32_t Search::alpha_beta(int32_t alpha, int32_t beta, const int32_t depth, const int32_t ply, const bool allow_null)
+{
+	const bool pv_node = (beta - alpha > 1);
+	pv_length[ply] = ply;
+	nodes++;
+	if (nodes >= next_check) {
+		check_limits();
+	}
+	if (stop) {
+		return 0;
+	}
+	// a position repeated once is scored as a draw, it could be repeated again
+	if (ply > 0 && (MoveGen::is_repetition(1) || MoveGen::is_fifty_moves())) {
+		RECORD_ENTER(ply, depth, alpha, beta, TransTable::pack_move(current_move[ply - 1]));
+		Stats::local.terminal_nodes++;
+		RECORD_LEAVE(0, NODE_TERMINAL, 0);
+		return 0;
+	}
+	if (depth <= 0 || ply >= MAX_PLY - 1) {
+		nodes--;  // counted again as a quiescence node
+		return quiescence(alpha, beta, ply);
+	}
+	RECORD_ENTER(ply, depth, alpha, beta, ply ? TransTable::pack_move(current_move[ply - 1]) : 0);
+
+	const uint64_t key = Hexbitboard::get_key();
+	tt_data entry;
+	uint16_t hash_move = 0;
+	Stats::local.tt_probes++;
+	if (TransTable::probe(key, entry)) {
+		Stats::local.tt_hits++;
+		hash_move = entry.move;
+		int32_t score = score_from_tt(entry.score, ply);
+		// hits inside the window of a pv node would cut the principal variation short
+		if (!pv_node && entry.depth >= depth) {
+			if (entry.bound == BOUND_EXACT
+					|| (entry.bound == BOUND_LOWER && score >= beta)
+					|| (entry.bound == BOUND_UPPER && score <= alpha)) {
+				Stats::local.tt_cutoffs++;
+				Stats::local.hash_nodes++;
+				RECORD_LEAVE(score, NODE_HASH, 0);
+				return score;
+			}
+		}
+	}
+
+	const bool in_check = Attacks::in_check();
+	const int32_t static_eval = in_check ? -INFINITE_SCORE : Eval::evaluate();
+
+	if (!pv_node && !in_check) {
+		if (options.razoring && depth <= RAZOR_DEPTH && static_eval + RAZOR_MARGIN * depth <= alpha) {
+			int32_t score = alpha_beta(alpha, alpha + 1, 0, ply, false);
+			if (score <= alpha) {
+				Stats::local.pruned_nodes++;
+				RECORD_LEAVE(score, NODE_PRUNED, 0);
+				return score;
+			}
+		}
+		bits128 own_knights = MoveGen::white_to_move ? Hexbitboard::get_white_knight() : Hexbitboard::get_black_knight();
+		// a side with the king alone is often in zugzwang
+		if (options.null_move && allow_null && depth >= NULL_MIN_DEPTH && static_eval >= beta && own_knights) {
+			int32_t reduction = NULL_REDUCTION + depth / 6;
+			current_move[ply].move = 0;
+			Stats::local.null_tries++;
+			MoveGen::make_null_move();
+			int32_t score = -alpha_beta(-beta, -beta + 1, depth - 1 - reduction, ply + 1, false);
+			MoveGen::unmake_null_move();
+			if (stop) {
+				return 0;
+			}
+			if (score >= beta) {
+				if (score > MATE_BOUND) {
+					score = beta;
+				}
+				if (depth < NULL_VERIFY_DEPTH) {
+					Stats::local.null_cutoffs++;
+					Stats::local.pruned_nodes++;
+					RECORD_LEAVE(score, NODE_PRUNED, 0);
+					return score;
+				}
+				// verification search without null moves guards against zugzwang
+				if (alpha_beta(beta - 1, beta, depth - reduction, ply, false) >= beta) {
+					Stats::local.null_cutoffs++;
+					Stats::local.pruned_nodes++;
+					RECORD_LEAVE(score, NODE_PRUNED, 0);
+					return score;
+				}
+			}
+		}
+	}
+	const bool futile = options.futility && !pv_node && !in_check && depth <= FUTILITY_DEPTH
+			&& static_eval + FUTILITY_MARGIN[depth] <= alpha;
+
+	move_t previous;
+	previous.move = 0;
+	if (ply > 0) {
+		previous = current_move[ply - 1];
+	}
+	uint64_t bottom = MoveGen::open_ply();
+	Attacks::generate_moves();
+	// each multi-pv line first tries its move from the previous iteration
+	if (ply == 0 && pv_index > 0 && lines[pv_index].pv_length) {
+		hash_move = TransTable::pack_move(lines[pv_index].pv[0]);
+	}
+	MoveOrder::score_moves(hash_move, ply, previous);
+
+	const int32_t old_alpha = alpha;
+	int32_t best_score = -INFINITE_SCORE;
+	uint16_t best_move = 0;
+	uint32_t legal = 0;
+	move_t quiets[QUIETS_MAX];
+	uint32_t quiets_number = 0;
+	for (uint64_t i = MoveGen::get_move_bottom(); i < MoveGen::get_move_top(); ++i) {
+		move_t move = MoveGen::pick_move(i);
+		if (ply == 0 && pv_index > 0 && is_excluded(move)) {
+			continue;
+		}
+		// a quiet move to a hex where the man is lost is reduced further
+		const bool bad_quiet = options.see && options.lmr && depth >= LMR_MIN_DEPTH
+				&& !MoveOrder::is_capture(move) && !See::see_ge(move, 0);
+		if (!MoveGen::make_move(move)) {
+			MoveGen::unmake_move();
+			continue;
+		}
+		legal++;
+		const bool capture = move.set[MOVE_TYPE] & CAPTURING;
+		const bool gives_check = Attacks::in_check();
+		if (futile && legal > 1 && !capture && !gives_check) {
+			MoveGen::unmake_move();
+			continue;
+		}
+		TransTable::prefetch(Hexbitboard::get_key());
+		current_move[ply] = move;
+
+		int32_t score;
+		bool full_depth = true;
+		if (options.lmr && depth >= LMR_MIN_DEPTH && legal > LMR_MIN_MOVES && !capture && !gives_check && !in_check) {
+			int32_t reduction = lmr_table[depth < MAX_PLY ? depth : MAX_PLY - 1][legal < uint32_t(MAX_PLY) ? legal : MAX_PLY - 1];
+			if (bad_quiet) {
+				reduction++;
+			}
+			if (reduction > 0) {
+				Stats::local.lmr_tries++;
+				score = -alpha_beta(-alpha - 1, -alpha, depth - 1 - reduction, ply + 1, true);
+				full_depth = (score > alpha);
+				Stats::local.lmr_researches += full_depth;
+			}
+		}
+		if (full_depth) {
+			if (options.pvs && legal > 1) {
+				score = -alpha_beta(-alpha - 1, -alpha, depth - 1, ply + 1, true);
+				if (score > alpha && score < beta) {
+					Stats::local.pvs_researches++;
+					score = -alpha_beta(-beta, -alpha, depth - 1, ply + 1, true);
+				}
+			}
+			else {
+				score = -alpha_beta(-beta, -alpha, depth - 1, ply + 1, true);
+			}
+		}
+		MoveGen::unmake_move();
+		if (stop) {
+			MoveGen::close_ply(bottom);
+			return 0;
+		}
+		if (score > best_score) {
+			best_score = score;
+			best_move = TransTable::pack_move(move);
+			if (score > alpha) {
+				alpha = score;
+				pv[ply][ply] = move;
+				for (int32_t j = ply + 1; j < pv_length[ply + 1]; ++j) {
+					pv[ply][j] = pv[ply + 1][j];
+				}
+				pv_length[ply] = pv_length[ply + 1];
+				if (score >= beta) {
+					if (!capture) {
+						MoveOrder::update(move, depth, ply, previous, quiets, quiets_number);
+					}
+					Stats::local.cutoffs++;
+					Stats::local.first_cutoffs += (legal == 1);
+					RECORD_CUTOFF(legal);
+					break;
+				}
+			}
+		}
+		if (!capture && quiets_number < QUIETS_MAX) {
+			quiets[quiets_number++] = move;
+		}
+	}
+	MoveGen::close_ply(bottom);
+
+	if (!legal) {
+		Stats::local.terminal_nodes++;
+		RECORD_LEAVE(in_check ? -MATE_SCORE + ply : 0, NODE_TERMINAL, 0);
+		return in_check ? -MATE_SCORE + ply : 0;
+	}
+
+	bound_type bound = (best_score >= beta) ? BOUND_LOWER : (alpha > old_alpha ? BOUND_EXACT : BOUND_UPPER);
+	if (bound == BOUND_LOWER) {
+		Stats::local.cut_nodes++;
+	}
+	else if (bound == BOUND_EXACT) {
+		Stats::local.pv_nodes++;
+	}
+	else {
+		Stats::local.all_nodes++;
+	}
+	RECORD_LEAVE(best_score, bound == BOUND_LOWER ? NODE_CUT : (bound == BOUND_EXACT ? NODE_PV : NODE_ALL), legal);
+	// the root result of a later multi-pv line is not the best move of the position
+	if (ply > 0 || pv_index == 0) {
+		TransTable::store(key, best_move, int16_t(score_to_tt(best_score, ply)), uint8_t(depth), bound);
+	}
+	return best_score;
+}
+
+/**
+ * resolves captures until the position is quiet, using the static
+ * evaluation as a stand pat score; when in check all evasions are tried
+ */
+int32_t Search::quiescence(int32_t alpha, const int32_t beta, const int32_t ply)
+{
+	pv_length[ply] = ply;
+	nodes++;
+	qnodes++;
+	Stats::local.qnodes++;
+	if (nodes >= next_check) {
+		check_limits();
+	}
+	if (stop) {
+		return 0;
+	}
+	RECORD_ENTER(ply, 0, alpha, beta, ply ? TransTable::pack_move(current_move[ply - 1]) : 0);
+
+	const bool in_check = Attacks::in_check();
+	int32_t best_score = -INFINITE_SCORE;
+	int32_t stand_pat = 0;
+	if (!in_check || ply >= MAX_PLY - 1) {
+		stand_pat = Eval::evaluate();
+		if (stand_pat >= beta || ply >= MAX_PLY - 1) {
+			RECORD_LEAVE(stand_pat, NODE_QUIESCENCE, 0);
+			return stand_pat;
+		}
+		if (stand_pat > alpha) {
+			alpha = stand_pat;
+		}
+		best_score = stand_pat;
+	}
+
+	move_t previous;
+	previous.move = 0;
+	if (ply > 0) {
+		previous = current_move[ply - 1];
+	}
+	uint64_t bottom = MoveGen::open_ply();
+	if (in_check) {
+		Attacks::generate_moves();
+	}
+	else {
+		Attacks::generate_captures();
+	}
+	MoveOrder::score_moves(0, ply, previous);
+
+	uint32_t legal = 0;
+	for (uint64_t i = MoveGen::get_move_bottom(); i < MoveGen::get_move_top(); ++i) {
+		move_t move = MoveGen::pick_move(i);
+		// even winning the victim for free cannot lift the score to alpha
+		if (!in_check && options.delta && stand_pat + MoveOrder::victim_value(move) + DELTA_MARGIN <= alpha) {
+			continue;
+		}
+		// a capture losing material cannot improve on standing pat
+		if (!in_check && options.see && !See::see_ge(move, 0)) {
+			continue;
+		}
+		if (!MoveGen::make_move(move)) {
+			MoveGen::unmake_move();
+			continue;
+		}
+		legal++;
+		current_move[ply] = move;
+		int32_t score = -quiescence(-beta, -alpha, ply + 1);
+		MoveGen::unmake_move();
+		if (stop) {
+			MoveGen::close_ply(bottom);
+			return 0;
+		}
+		if (score > best_score) {
+			best_score = score;
+			if (score > alpha) {
+				alpha = score;
+				pv[ply][ply] = move;
+				for (int32_t j = ply + 1; j < pv_length[ply + 1]; ++j) {
+					pv[ply][j] = pv[ply + 1][j];
+				}
+				pv_length[ply] = pv_length[ply + 1];
+				if (score >= beta) {
+					RECORD_CUTOFF(legal);
+					break;
+				}
+			}
+		}
+	}
+	MoveGen::close_ply(bottom);
+
+	if (in_check && !legal) {
+		RECORD_LEAVE(-MATE_SCORE + ply, NODE_TERMINAL, 0);
+		return -MATE_SCORE + ply;
+	}
+	RECORD_LEAVE(best_score, NODE_QUIESCENCE, legal);
+	return best_score;
+}
+
+/**
+ * searches the root in a narrow window around the previous score and
+ * widens it on the side that failed until the score falls inside
+ */
+int32_t Search::aspiration(const int32_t depth, const int32_t previous)
+{
+	if (!options.aspiration || depth < ASPIRATION_DEPTH || previous > MATE_BOUND || previous < -MATE_BOUND) {
+		return alpha_beta(-INFINITE_SCORE, INFINITE_SCORE, depth, 0, true);
+	}
+	int32_t delta = ASPIRATION_WINDOW;
+	int32_t alpha = previous - delta;
+	int32_t beta = previous + delta;
+	for (;;) {
+		int32_t score = alpha_beta(alpha, beta, depth, 0, true);
+		if (stop) {
+			return score;
+		}
+		if (score <= alpha || score >= beta) {
+			Stats::local.aspiration_researches++;
+		}
+		if (score <= alpha) {
+			alpha = (score - delta > -INFINITE_SCORE) ? score - delta : -INFINITE_SCORE;
+		}
+		else if (score >= beta) {
+			beta = (score + delta < INFINITE_SCORE) ? score + delta : INFINITE_SCORE;
+		}
+		else {
+			return score;
+		}
+		delta *= 2;
+	}
+}
+
+/**
+ * iterative deepening of one thread, helpers skip some depths; each
+ * completed iteration is saved in the thread's result
+ */
+void Search::iterate(const uint32_t id)
+{
+	thread_result &result = results[id];
+	Stats::begin_thread();
+	RECORD_OPEN(id);
+	// helpers only fill the hash for the best line
+	const uint32_t line_number = (id == 0 && multipv < root_moves) ? multipv : (id == 0 ? root_moves : 1);
+	for (uint32_t i = 0; i < line_number; ++i) {
+		lines[i].score = 0;
+		lines[i].pv_length = 0;
+	}
+	for (int32_t depth = 1; depth < MAX_PLY; ++depth) {
+		// the depth limit is only known after a ponder hit
+		if (!pondering && limits.depth > 0 && depth > limits.depth) {
+			break;
+		}
+		if (id > 0) {
+			const uint32_t i = (id - 1) % SKIP_PATTERNS;
+			if (((depth + skip_phase[i]) / skip_size[i]) % 2) {
+				continue;
+			}
+		}
+		for (pv_index = 0; pv_index < line_number; ++pv_index) {
+			int32_t score = aspiration(depth, lines[pv_index].score);
+			if (stop) {
+				break;
+			}
+			lines[pv_index].score = score;
+			lines[pv_index].pv_length = pv_length[0];
+			for (int32_t i = 0; i < pv_length[0]; ++i) {
+				lines[pv_index].pv[i] = pv[0][i];
+			}
+		}
+		if (stop) {
+			if (!result.pv_length && pv_index == 0 && pv_length[0]) {  // stopped inside the first iteration
+				result.pv[0] = pv[0][0];
+				result.pv_length = 1;
+			}
+			break;
+		}
+		// a line may come out better than an earlier one after its re-search
+		std::stable_sort(lines, lines + line_number, [](const root_line &a, const root_line &b) {
+			return a.score > b.score;
+		});
+		result.depth = depth;
+		result.score = lines[0].score;
+		if (id == 0) {
+			Stats::iteration_done(depth, nodes);
+		}
+		result.pv_length = lines[0].pv_length;
+		for (int32_t i = 0; i < lines[0].pv_length; ++i) {
+			result.pv[i] = lines[0].pv[i];
+		}
+		if (id == 0 && verbose) {
+			for (uint32_t i = 0; i < line_number; ++i) {
+				print_line(i, depth);
+			}
+		}
+		if (line_number == 1 && (result.score > MATE_BOUND || result.score < -MATE_BOUND)) {
+			break;
+		}
+		if (id == 0 && TimeManager::iteration_done(lines[0].pv[0], lines[0].score, elapsed())) {
+			break;
+		}
+	}
+	pv_index = 0;
+	results[id].nodes.store(nodes, std::memory_order_relaxed);
+	results[id].qnodes.store(qnodes, std::memory_order_relaxed);
+	Stats::merge();
+	RECORD_CLOSE();
+}
+
+// root moves already taken by the better lines of this iteration
+bool Search::is_excluded(const move_t move)
+{
+	for (uint32_t i = 0; i < pv_index; ++i) {
+		if (MoveOrder::same_move(move, lines[i].pv[0])) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void Search::print_line(const uint32_t index, const int32_t depth)
+{
+	uint64_t time = elapsed();
+	uint64_t total = get_nodes();
+	cout << "depth " << depth;
+	if (multipv > 1) {
+		cout << " multipv " << index + 1;
+	}
+	cout << " score " << score_to_str(lines[index].score) << " nodes " << total
+		 << " qnodes " << get_qnodes() << " nps " << (total * 1000 / (time ? time : 1)) << " time " << time
+		 << " hashfull " << TransTable::hashfull() << " pv" << pv_to_str(lines[index].pv, lines[index].pv_length) << endl;
+}
+
+/**
+ * body of a helper thread: sets up its own copy of the position and
+ * searches it, sharing only the hash table with the others
+ */
+void Search::helper(const uint32_t id, const bitmaps board, const bool white, const std::vector<uint64_t> history)
+{
+	thread_id = id;
+	nodes = 0;
+	qnodes = 0;
+	next_check = CHECK_NODES;
+	check_interval = CHECK_NODES;
+	MoveGen::white_to_move = white;
+	Hexbitboard::set_bitboards(board);
+	MoveGen::set_history(history);
+	MoveGen::reset_move_stack();
+	Attacks::init();
+	iterate(id);
+}
+
+/**
+ * quiescence search of the current position in the calling thread without
+ * limits, the line leads to the quiet position its score comes from
+ */
+int32_t Search::quiet_line(move_t *line, int32_t &length)
+{
+	nodes = 0;
+	qnodes = 0;
+	next_check = UINT64_MAX;
+	const int32_t score = quiescence(-INFINITE_SCORE, INFINITE_SCORE, 0);
+	length = pv_length[0];
+	for (int32_t i = 0; i < length; ++i) {
+		line[i] = pv[0][i];
+	}
+	return score;
+}
+
+#ifdef __linux__
+static void pin_thread(const pthread_t thread, const uint32_t id)
+{
+	const uint32_t cores = std::thread::hardware_concurrency();
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cores ? id % cores : 0, &set);
+	pthread_setaffinity_np(thread, sizeof(set), &set);
+}
+#endif
+
+// searches the current position in the calling thread
+move_t Search::think(const search_limits new_limits)
+{
+	limits = new_limits;
+	start = std::chrono::steady_clock::now();
+	TimeManager::new_search();
+	if (limits.clock) {
+		TimeManager::start(limits.clock, limits.increment, limits.moves_to_go, 0);
+		limits.time = TimeManager::get_maximum();
+	}
+	stop = false;
+	pondering = false;
+	searching = true;
+	return search();
+}
+
+/**
+ * thinks on the current position in a background thread without limits,
+ * until ponder_hit() sets them or stop_thinking() ends the search
+ */
+void Search::start_pondering()
+{
+	search_limits none = { 0, 0, 0, 0, 0, 0 };
+	limits = none;
+	start = std::chrono::steady_clock::now();
+	TimeManager::new_search();
+	stop = false;
+	pondering = true;
+	searching = true;
+	background = std::thread(think_in_background, Hexbitboard::get_bitboards(), MoveGen::white_to_move, MoveGen::get_history());
+}
+
+/**
+ * the expected move was played: the ponder search goes on as the real
+ * one, its time limit and clock budgets count from now
+ */
+void Search::ponder_hit(const search_limits new_limits)
+{
+	search_limits hit = new_limits;
+	if (hit.clock) {
+		TimeManager::start(hit.clock, hit.increment, hit.moves_to_go, elapsed());
+		hit.time = TimeManager::get_maximum();
+	}
+	if (hit.time) {
+		hit.time += elapsed();
+	}
+	limits = hit;
+	pondering = false;
+}
+
+move_t Search::wait_thinking()
+{
+	background.join();
+	return background_move;
+}
+
+move_t Search::stop_thinking()
+{
+	stop = true;
+	pondering = false;
+	return wait_thinking();
+}
+
+void Search::think_in_background(const bitmaps board, const bool white, const std::vector<uint64_t> history)
+{
+	MoveGen::white_to_move = white;
+	Hexbitboard::set_bitboards(board);
+	MoveGen::set_history(history);
+	MoveGen::reset_move_stack();
+	Attacks::init();
+	background_move = search();
+}
+
+/**
+ * Lazy SMP: the calling thread and threads - 1 helpers search the same
+ * position independently, sharing the hash table; the deepest completed
+ * iteration of any thread gives the move
+ * @return best move, move 0 if there is none
+ */
+move_t Search::search()
+{
+	thread_id = 0;
+	nodes = 0;
+	qnodes = 0;
+	next_check = CHECK_NODES;
+	check_interval = CHECK_NODES;
+	TransTable::new_search();
+	MoveOrder::new_search();
+	Stats::clear();
+	MoveGen::reset_move_stack();
+
+	move_t best;
+	best.move = 0;
+	Attacks::generate_moves();
+	root_moves = uint32_t(MoveGen::remove_unlegal_moves());
+	if (!root_moves) {  // mate or stalemate at the root
+		ponder_move.move = 0;
+		MoveGen::reset_move_stack();
+		Attacks::init();
+		searching = false;
+		return best;
+	}
+	MoveGen::reset_move_stack();
+
+	for (uint32_t i = 0; i < threads; ++i) {
+		results[i].depth = 0;
+		results[i].score = 0;
+		results[i].pv_length = 0;
+		results[i].nodes = 0;
+		results[i].qnodes = 0;
+	}
+#ifdef __linux__
+	cpu_set_t main_cores;
+	if (options.pin) {
+		pthread_getaffinity_np(pthread_self(), sizeof(main_cores), &main_cores);
+		pin_thread(pthread_self(), 0);
+	}
+#endif
+	std::vector<std::thread> helpers;
+	for (uint32_t i = 1; i < threads; ++i) {
+		helpers.emplace_back(helper, i, Hexbitboard::get_bitboards(), MoveGen::white_to_move, MoveGen::get_history());
+#ifdef __linux__
+		if (options.pin) {
+			pin_thread(helpers.back().native_handle(), i);
+		}
+#endif
+	}
+	iterate(0);
+	stop = true;
+	for (std::thread &thread : helpers) {
+		thread.join();
+	}
+#ifdef __linux__
+	if (options.pin) {
+		pthread_setaffinity_np(pthread_self(), sizeof(main_cores), &main_cores);
+	}
+#endif
+
+	uint32_t chosen = 0;
+	for (uint32_t i = 1; i < threads; ++i) {
+		if (results[i].depth > results[chosen].depth
+				|| (results[i].depth == results[chosen].depth && results[i].score > results[chosen].score)) {
+			chosen = i;
+		}
+	}
+	const thread_result &result = results[chosen];
+	if (chosen && verbose) {
+		cout << "depth " << result.depth << " score " << score_to_str(result.score) << " thread " << chosen
+			 << " pv" << pv_to_str(result.pv, result.pv_length) << endl;
+	}
+	ponder_move.move = 0;
+	if (result.pv_length) {
+		best = result.pv[0];
+	}
+	if (result.pv_length > 1) {
+		ponder_move = result.pv[1];
+	}
+	Attacks::init();
+	searching = false;
+	return best;
+}
+
+/**
+ * time to depth of the current position for 1, 2, 4, 8 and 16 threads,
+ * each run starts from an empty hash
+ */
+void Search::scaling(const int32_t depth)
+{
+	const uint32_t saved_threads = threads;
+	const uint32_t counts[] = { 1, 2, 4, 8, 16 };
+	uint64_t base_time = 0;
+	verbose = false;
+	cout << "cores " << std::thread::hardware_concurrency() << ", depth " << depth << endl;
+	for (uint32_t count : counts) {
+		threads = count;
+		TransTable::clear();
+		MoveOrder::clear();
+		Eval::clear_cache();
+		search_limits run = { depth, 0, 0, 0, 0, 0 };
+		think(run);
+		uint64_t time = elapsed();
+		uint64_t total = get_nodes();
+		if (!base_time) {
+			base_time = time ? time : 1;
+		}
+		cout << "threads " << std::setw(2) << count << " time " << std::setw(7) << time << " ms nodes "
+			 << std::setw(10) << total << " nps " << std::setw(9) << (total * 1000 / (time ? time : 1))
+			 << " speedup " << std::fixed << std::setprecision(2) << double(base_time) / double(time ? time : 1) << endl;
+	}
+	cout.unsetf(std::ios::fixed);
+	threads = saved_threads;
+	verbose = true;
+}
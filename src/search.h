@@ -0,0 +1,180 @@
+/*
+***************************************************************************
+**
+** Copyright (C) 2011 Zbigniew Sienkiewicz.
+** All rights reserved.
+**
+** Glaucus is Glinski's hexagonal chess engine.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+***************************************************************************
+*/
+
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <inttypes.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "movegen.h"
+#include "hexbitboard.h"
+
+const int32_t MAX_PLY = 64;
+const int32_t INFINITE_SCORE = 32000;
+const int32_t MATE_SCORE = 31000;
+const int32_t MATE_BOUND = MATE_SCORE - MAX_PLY;
+const uint32_t QUIETS_MAX = 64;
+const uint64_t DEFAULT_MOVE_TIME = 1000;  // ms
+const uint64_t CHECK_NODES = 1024;  // nodes before the first limit check
+const uint64_t CHECK_NODES_MIN = 64;
+const uint64_t CHECK_NODES_MAX = 1 << 16;
+const uint64_t DEFAULT_SLACK = 5;  // ms a search may run past its deadline
+const int32_t ASPIRATION_DEPTH = 4;
+const int32_t ASPIRATION_WINDOW = 30;
+const int32_t NULL_MIN_DEPTH = 3;
+const int32_t NULL_REDUCTION = 3;
+const int32_t NULL_VERIFY_DEPTH = 6;
+const int32_t LMR_MIN_DEPTH = 3;
+const uint32_t LMR_MIN_MOVES = 3;
+const int32_t FUTILITY_DEPTH = 3;
+const int32_t FUTILITY_MARGIN[FUTILITY_DEPTH + 1] = { 0, 200, 350, 500 };
+const int32_t RAZOR_DEPTH = 2;
+const int32_t RAZOR_MARGIN = 250;
+const int32_t DELTA_MARGIN = 200;
+const uint32_t THREADS_MAX = 64;
+const uint32_t MULTIPV_MAX = 32;
+const uint32_t SKIP_PATTERNS = 20;
+
+struct search_options {
+	bool pvs;
+	bool aspiration;
+	bool null_move;
+	bool lmr;
+	bool futility;
+	bool razoring;
+	bool delta;
+	bool see;
+	bool pin;  // pins search threads to cores
+	bool ponder;  // the engine plays its move and thinks on the expected reply
+};
+
+/**
+ * last completed iteration of one search thread, the node counters are
+ * published at every limit check so the main thread can sum them
+ */
+struct thread_result {
+	int32_t depth;
+	int32_t score;
+	move_t pv[MAX_PLY];
+	int32_t pv_length;
+	std::atomic<uint64_t> nodes;
+	std::atomic<uint64_t> qnodes;
+};
+
+// one line of a multi-pv search
+struct root_line {
+	int32_t score;
+	move_t pv[MAX_PLY];
+	int32_t pv_length;
+};
+
+struct search_limits {
+	int32_t depth;   // 0 means no limit
+	uint64_t time;   // ms, 0 means no limit
+	uint64_t nodes;  // 0 means no limit
+	uint64_t clock;  // ms left on the clock, 0 means none; sets the time limit
+	uint64_t increment;  // ms
+	uint32_t moves_to_go;  // 0 means the rest of the game
+};
+
+class Search
+{
+public:
+	static void init();
+	static move_t think(const search_limits limits);
+	static void start_pondering();
+	static void ponder_hit(const search_limits limits);
+	static move_t wait_thinking();
+	static move_t stop_thinking();
+	static bool is_thinking() { return background.joinable(); }
+	static move_t get_ponder_move() { return ponder_move; }
+	static bool get_ponder() { return options.ponder; }
+	static bool is_searching() { return searching; }
+	static void request_stop() { stop = true; }
+	static void clear_stop() { stop = false; }
+	static void set_slack(const uint64_t milliseconds) { slack = milliseconds ? milliseconds : 1; }
+	static uint64_t get_slack() { return slack; }
+	static std::string score_to_str(const int32_t score);
+	static bool set_option(const std::string name, const bool value);
+	static std::string get_options();
+	static bool set_threads(const uint32_t number);
+	static uint32_t get_threads() { return threads; }
+	static uint64_t get_nodes();
+	static bool set_multipv(const uint32_t number);
+	static uint32_t get_multipv() { return multipv; }
+	static void scaling(const int32_t depth);
+	static int32_t quiet_line(move_t *line, int32_t &length);
+private:
+	Search();
+	static int32_t alpha_beta(int32_t alpha, int32_t beta, const int32_t depth, const int32_t ply, const bool allow_null);
+	static int32_t quiescence(int32_t alpha, const int32_t beta, const int32_t ply);
+	static int32_t aspiration(const int32_t depth, const int32_t previous);
+	static move_t search();
+	static void think_in_background(const bitmaps board, const bool white, const std::vector<uint64_t> history);
+	static void iterate(const uint32_t id);
+	static void helper(const uint32_t id, const bitmaps board, const bool white, const std::vector<uint64_t> history);
+	static uint64_t get_qnodes();
+	static bool is_excluded(const move_t move);
+	static void print_line(const uint32_t index, const int32_t depth);
+	static void check_limits();
+	static uint64_t elapsed();
+	static uint64_t elapsed_micro();
+	static std::string pv_to_str(const move_t *line, const int32_t length);
+	static int32_t score_to_tt(const int32_t score, const int32_t ply);
+	static int32_t score_from_tt(const int32_t score, const int32_t ply);
+	static search_limits limits;
+	static search_options options;
+	static int32_t lmr_table[MAX_PLY][MAX_PLY];
+	static std::chrono::steady_clock::time_point start;
+	static uint32_t threads;
+	static uint32_t multipv;
+	static uint32_t root_moves;
+	static bool verbose;
+	static std::atomic<bool> stop;
+	static std::atomic<bool> searching;
+	static uint64_t slack;
+	static std::atomic<bool> pondering;  // no limits apply until the ponder hit
+	static std::thread background;
+	static move_t background_move;
+	static move_t ponder_move;
+	static thread_result results[THREADS_MAX];
+	static const int32_t skip_size[SKIP_PATTERNS];
+	static const int32_t skip_phase[SKIP_PATTERNS];
+	static thread_local uint32_t thread_id;
+	static thread_local uint64_t nodes;
+	static thread_local uint64_t qnodes;
+	static thread_local uint64_t next_check;
+	static thread_local uint64_t check_interval;
+	static thread_local move_t pv[MAX_PLY][MAX_PLY];
+	static thread_local move_t current_move[MAX_PLY];
+	static thread_local int32_t pv_length[MAX_PLY];
+	static thread_local uint32_t pv_index;
+	static thread_local root_line lines[MULTIPV_MAX];
+};
+
+#endif // SEARCH_H
@@ -0,0 +1,160 @@
+/*
+***************************************************************************
+**
+** Copyright (C) 2011 Zbigniew Sienkiewicz.
+** All rights reserved.
+**
+** Glaucus is Glinski's hexagonal chess engine.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+***************************************************************************
+*/
+
+#include <algorithm>
+#include "see.h"
+#include "attacks.h"
+#include "eval.h"
+
+/**
+ * all men of both colours attacking the hex, only those still standing on
+ * the occupied bitboard are taken into account
+ */
+bits128 See::attackers_to(const uint8_t position, const bits128 occupied)
+{
+	bits128 knights = Hexbitboard::get_white_knight() | Hexbitboard::get_black_knight();
+	bits128 kings = Hexbitboard::get_white_king() | Hexbitboard::get_black_king();
+	return ((Attacks::knight_attacks[position] & knights) | (Attacks::king_attacks[position] & kings)) & occupied;
+}
+
+int32_t See::man_value(const uint8_t position)
+{
+	if (Hexbitboard::is_set_white_knight(position) || Hexbitboard::is_set_black_knight(position)) {
+		return KNIGHT_VALUE;
+	}
+	if (Hexbitboard::is_set_white_king(position) || Hexbitboard::is_set_black_king(position)) {
+		return SEE_KING_VALUE;
+	}
+	return 0;
+}
+
+/**
+ * picks the cheapest attacker of the given colour, returns false if the
+ * colour has none left
+ */
+bool See::least_valuable(const bits128 attackers, const bool white, uint8_t &position)
+{
+	bits128 knights = attackers & (white ? Hexbitboard::get_white_knight() : Hexbitboard::get_black_knight());
+	if (knights) {
+		position = Hexbitboard::get_lsb(knights);
+		return true;
+	}
+	bits128 king = attackers & (white ? Hexbitboard::get_white_king() : Hexbitboard::get_black_king());
+	if (king) {
+		position = Hexbitboard::get_lsb(king);
+		return true;
+	}
+	return false;
+}
+
+/**
+ * material balance of the exchange started by the move, from the view of
+ * the side making it; a king recaptures only if the hex is not defended
+ */
+int32_t See::see(const move_t move)
+{
+	const uint8_t to = move.set[PIECE_TO];
+	const bits128 single = { 1, 0 };
+	int32_t gain[SEE_SWAP_MAX];
+	bool white = (move.set[COLOR_PIECE] & WHITE) != 0;
+	uint8_t from = move.set[PIECE_FROM];
+	uint32_t depth = 0;
+
+	gain[0] = man_value(to);
+	int32_t on_target = man_value(from);
+	bits128 occupied = (Hexbitboard::get_white() | Hexbitboard::get_black()) & ~(single << from);
+	bits128 attackers = attackers_to(to, occupied);
+	while (depth + 1 < SEE_SWAP_MAX) {
+		white = !white;
+		if (!least_valuable(attackers, white, from)) {
+			break;
+		}
+		if (man_value(from) == SEE_KING_VALUE && (attackers & (white ? Hexbitboard::get_black() : Hexbitboard::get_white()))) {
+			break;
+		}
+		depth++;
+		gain[depth] = on_target - gain[depth - 1];
+		on_target = man_value(from);
+		occupied &= ~(single << from);
+		attackers &= occupied;
+	}
+	while (depth > 0) {
+		gain[depth - 1] = -std::max(-gain[depth - 1], gain[depth]);
+		depth--;
+	}
+	return gain[0];
+}
+
+/**
+ * whether the exchange wins at least the threshold, stops as soon as the
+ * outcome is decided; the attack counts settle an undefended or an
+ * unsupported mover without walking the attackers
+ */
+bool See::see_ge(const move_t move, const int32_t threshold)
+{
+	const uint8_t to = move.set[PIECE_TO];
+	const uint8_t from = move.set[PIECE_FROM];
+	const bits128 single = { 1, 0 };
+
+	int32_t swap = man_value(to) - threshold;
+	if (swap < 0) {
+		return false;
+	}
+	swap = man_value(from) - swap;
+	if (swap <= 0) {
+		return true;
+	}
+	// the mover itself attacks the target, so a second own attack is a defender
+	const bool white_mover = (move.set[COLOR_PIECE] & WHITE) != 0;
+	const attack_counts &enemy = Attacks::count_attacks(!white_mover);
+	if (!Hexbitboard::is_set(enemy.once, to)) {
+		return true;
+	}
+	if (!Hexbitboard::is_set(Attacks::count_attacks(white_mover).twice, to)) {
+		return false;
+	}
+	bits128 occupied = (Hexbitboard::get_white() | Hexbitboard::get_black()) & ~(single << from);
+	bits128 attackers = attackers_to(to, occupied);
+	bool white = white_mover;
+	bool result = true;
+	uint8_t position;
+	while (true) {
+		white = !white;
+		if (!least_valuable(attackers, white, position)) {
+			break;
+		}
+		result = !result;
+		if (man_value(position) == SEE_KING_VALUE) {
+			// the king captures only if nothing of the other side is left
+			return (attackers & (white ? Hexbitboard::get_black() : Hexbitboard::get_white())) ? !result : result;
+		}
+		swap = KNIGHT_VALUE - swap;
+		if (swap < int32_t(result)) {
+			break;
+		}
+		occupied &= ~(single << position);
+		attackers &= occupied;
+	}
+	return result;
+}
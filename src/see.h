@@ -0,0 +1,51 @@
+/*
+***************************************************************************
+**
+** Copyright (C) 2011 Zbigniew Sienkiewicz.
+** All rights reserved.
+**
+** Glaucus is Glinski's hexagonal chess engine.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+***************************************************************************
+*/
+
+#ifndef SEE_H
+#define SEE_H
+
+#include <inttypes.h>
+#include "hexbitboard.h"
+#include "movegen.h"
+
+const int32_t SEE_KING_VALUE = 10000;  // never traded, only the last capturer
+const uint32_t SEE_SWAP_MAX = 32;
+
+/**
+ * Static exchange evaluation: resolves the captures on the target hex of
+ * a move with the cheapest attacker first, without making any move.
+ */
+class See
+{
+public:
+	static int32_t see(const move_t move);
+	static bool see_ge(const move_t move, const int32_t threshold);
+	static bits128 attackers_to(const uint8_t position, const bits128 occupied);
+private:
+	See();
+	static int32_t man_value(const uint8_t position);
+	static bool least_valuable(const bits128 attackers, const bool white, uint8_t &position);
+};
+
+#endif // SEE_H
@@ -0,0 +1,146 @@
+/*
+***************************************************************************
+**
+** Copyright (C) 2011 Zbigniew Sienkiewicz.
+** All rights reserved.
+**
+** Glaucus is Glinski's hexagonal chess engine.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+***************************************************************************
+*/
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include "stats.h"
+#include "eval.h"
+
+using std::cout;
+using std::endl;
+
+thread_local search_stats Stats::local;
+search_stats Stats::total;
+uint64_t Stats::depth_nodes[STATS_DEPTH_MAX];
+int32_t Stats::depths = 0;
+std::mutex Stats::mutex;
+thread_local uint64_t Stats::eval_hits_base = 0;
+thread_local uint64_t Stats::eval_misses_base = 0;
+
+Stats::Stats()
+{
+}
+
+// forgets the previous search, called before its threads start
+void Stats::clear()
+{
+	total = search_stats();
+	depths = 0;
+}
+
+// zeroes the counters of the calling thread when its search starts
+void Stats::begin_thread()
+{
+	local = search_stats();
+	eval_hits_base = Eval::get_cache_hits();
+	eval_misses_base = Eval::get_cache_misses();
+}
+
+// adds the counters of the calling thread to the totals when its search ends
+void Stats::merge()
+{
+	local.eval_cache_hits = Eval::get_cache_hits() - eval_hits_base;
+	local.eval_cache_misses = Eval::get_cache_misses() - eval_misses_base;
+	// the counters are all uint64_t, added up as an array
+	const uint64_t *from = reinterpret_cast<const uint64_t *>(&local);
+	uint64_t *to = reinterpret_cast<uint64_t *>(&total);
+	std::lock_guard<std::mutex> lock(mutex);
+	for (size_t i = 0; i < sizeof(search_stats) / sizeof(uint64_t); ++i) {
+		to[i] += from[i];
+	}
+}
+
+void Stats::iteration_done(const int32_t depth, const uint64_t nodes)
+{
+	if (depth > 0 && depth <= STATS_DEPTH_MAX) {
+		depth_nodes[depth - 1] = nodes;
+		depths = depth;
+	}
+}
+
+std::string Stats::percent(const uint64_t part, const uint64_t whole)
+{
+	std::ostringstream text;
+	text << std::fixed << std::setprecision(1) << (whole ? 100.0 * double(part) / double(whole) : 0.0) << "%";
+	return text.str();
+}
+
+void Stats::print()
+{
+	const search_stats &s = total;
+	const uint64_t full = s.pv_nodes + s.cut_nodes + s.all_nodes + s.hash_nodes + s.pruned_nodes + s.terminal_nodes;
+	cout << "nodes pv " << s.pv_nodes << " cut " << s.cut_nodes << " all " << s.all_nodes << " hash " << s.hash_nodes
+		 << " pruned " << s.pruned_nodes << " terminal " << s.terminal_nodes << " quiescence " << s.qnodes << endl;
+	cout << "cutoffs " << s.cutoffs << ", by the first move " << percent(s.first_cutoffs, s.cutoffs) << endl;
+	cout << "hash probes " << s.tt_probes << ", hits " << percent(s.tt_hits, s.tt_probes)
+		 << ", cutoffs " << percent(s.tt_cutoffs, s.tt_probes) << endl;
+	cout << "null move tries " << s.null_tries << ", cutoffs " << percent(s.null_cutoffs, s.null_tries) << endl;
+	cout << "lmr tries " << s.lmr_tries << ", re-searched " << percent(s.lmr_researches, s.lmr_tries) << endl;
+	cout << "pvs re-searches " << s.pvs_researches << ", aspiration re-searches " << s.aspiration_researches << endl;
+	cout << "eval cache hits " << percent(s.eval_cache_hits, s.eval_cache_hits + s.eval_cache_misses)
+		 << " of " << s.eval_cache_hits + s.eval_cache_misses << endl;
+	cout << "full width nodes " << full << endl;
+	for (int32_t depth = 1; depth <= depths; ++depth) {
+		const uint64_t nodes = depth_nodes[depth - 1] - (depth > 1 ? depth_nodes[depth - 2] : 0);
+		const uint64_t previous = depth > 2 ? depth_nodes[depth - 2] - depth_nodes[depth - 3] : (depth > 1 ? depth_nodes[0] : 0);
+		cout << "depth " << std::setw(2) << depth << " nodes " << std::setw(10) << nodes;
+		if (previous) {
+			cout << " branching " << std::fixed << std::setprecision(2) << double(nodes) / double(previous);
+		}
+		cout << endl;
+	}
+}
+
+void Stats::write_json(std::ostream &out)
+{
+	const search_stats &s = total;
+	out << "{\n"
+		<< "  \"nodes\": {\"pv\": " << s.pv_nodes << ", \"cut\": " << s.cut_nodes << ", \"all\": " << s.all_nodes
+		<< ", \"hash\": " << s.hash_nodes << ", \"pruned\": " << s.pruned_nodes << ", \"terminal\": " << s.terminal_nodes
+		<< ", \"quiescence\": " << s.qnodes << "},\n"
+		<< "  \"cutoffs\": " << s.cutoffs << ",\n"
+		<< "  \"first_move_cutoffs\": " << s.first_cutoffs << ",\n"
+		<< "  \"tt\": {\"probes\": " << s.tt_probes << ", \"hits\": " << s.tt_hits << ", \"cutoffs\": " << s.tt_cutoffs << "},\n"
+		<< "  \"null_move\": {\"tries\": " << s.null_tries << ", \"cutoffs\": " << s.null_cutoffs << "},\n"
+		<< "  \"lmr\": {\"tries\": " << s.lmr_tries << ", \"researches\": " << s.lmr_researches << "},\n"
+		<< "  \"pvs_researches\": " << s.pvs_researches << ",\n"
+		<< "  \"aspiration_researches\": " << s.aspiration_researches << ",\n"
+		<< "  \"eval_cache\": {\"hits\": " << s.eval_cache_hits << ", \"misses\": " << s.eval_cache_misses << "},\n"
+		<< "  \"depth_nodes\": [";
+	for (int32_t depth = 1; depth <= depths; ++depth) {
+		out << (depth > 1 ? ", " : "") << depth_nodes[depth - 1] - (depth > 1 ? depth_nodes[depth - 2] : 0);
+	}
+	out << "]\n}\n";
+}
+
+bool Stats::save_json(const std::string file_name)
+{
+	std::ofstream file(file_name, std::ios::trunc);
+	if (!file) {
+		return false;
+	}
+	write_json(file);
+	return bool(file);
+}
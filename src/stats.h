@@ -0,0 +1,85 @@
+/*
+***************************************************************************
+**
+** Copyright (C) 2011 Zbigniew Sienkiewicz.
+** All rights reserved.
+**
+** Glaucus is Glinski's hexagonal chess engine.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+***************************************************************************
+*/
+#ifndef STATS_H
+#define STATS_H
+
+#include <inttypes.h>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+const int32_t STATS_DEPTH_MAX = 64;
+
+// counters of one search, every search thread collects its own
+struct search_stats {
+	uint64_t pv_nodes;   // a move raised alpha without a cutoff
+	uint64_t cut_nodes;  // a move failed high
+	uint64_t all_nodes;  // no move raised alpha
+	uint64_t hash_nodes;      // cut off by a hash entry before the moves
+	uint64_t pruned_nodes;    // cut off by razoring or a null move
+	uint64_t terminal_nodes;  // draws by rule, mates and stalemates
+	uint64_t qnodes;
+	uint64_t cutoffs;
+	uint64_t first_cutoffs;  // cutoffs by the first legal move
+	uint64_t tt_probes;
+	uint64_t tt_hits;
+	uint64_t tt_cutoffs;
+	uint64_t null_tries;
+	uint64_t null_cutoffs;
+	uint64_t lmr_tries;
+	uint64_t lmr_researches;  // reduced searches failing high, searched again at full depth
+	uint64_t pvs_researches;  // null window searches searched again with the full window
+	uint64_t aspiration_researches;
+	uint64_t eval_cache_hits;
+	uint64_t eval_cache_misses;
+};
+
+/**
+ * Search statistics: the threads count in their own counters without any
+ * synchronisation and add them to the totals when their search ends;
+ * the main thread also records the nodes of every iteration.
+ */
+class Stats
+{
+public:
+	static void clear();
+	static void begin_thread();
+	static void merge();
+	static void iteration_done(const int32_t depth, const uint64_t nodes);
+	static void print();
+	static void write_json(std::ostream &out);
+	static bool save_json(const std::string file_name);
+	static thread_local search_stats local;
+private:
+	Stats();
+	static std::string percent(const uint64_t part, const uint64_t whole);
+	static search_stats total;
+	static uint64_t depth_nodes[STATS_DEPTH_MAX];  // nodes of the main thread when the depth was completed
+	static int32_t depths;
+	static std::mutex mutex;
+	static thread_local uint64_t eval_hits_base;
+	static thread_local uint64_t eval_misses_base;
+};
+
+#endif // STATS_H
@@ -0,0 +1,111 @@
+/*
+***************************************************************************
+**
+** Copyright (C) 2011 Zbigniew Sienkiewicz.
+** All rights reserved.
+**
+** Glaucus is Glinski's hexagonal chess engine.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+***************************************************************************
+*/
+#include <algorithm>
+#include "timeman.h"
+#include "moveorder.h"
+
+uint64_t TimeManager::optimum = 0;
+uint64_t TimeManager::maximum = 0;
+uint64_t TimeManager::offset = 0;
+std::atomic<bool> TimeManager::active(false);
+move_t TimeManager::previous_best;
+int32_t TimeManager::previous_score = 0;
+uint32_t TimeManager::stability = 0;
+uint32_t TimeManager::iterations = 0;
+uint64_t TimeManager::previous_time = 0;
+uint64_t TimeManager::last_duration = 0;
+uint64_t TimeManager::growth = GROWTH_DEFAULT;
+
+TimeManager::TimeManager()
+{
+}
+
+// forgets the iterations of the previous search, no budget applies until start()
+void TimeManager::new_search()
+{
+	active = false;
+	previous_best.move = 0;
+	previous_score = 0;
+	stability = 0;
+	iterations = 0;
+	previous_time = 0;
+	last_duration = 0;
+	growth = GROWTH_DEFAULT;
+}
+
+/**
+ * sets the budgets for a clock with the given remaining time and
+ * increment, the increments of the moves to go are counted in advance
+ * @param searched ms already searched when pondering, the budgets start after it
+ */
+void TimeManager::start(const uint64_t clock, const uint64_t increment, const uint32_t moves_to_go, const uint64_t searched)
+{
+	const uint64_t moves = moves_to_go ? std::min(moves_to_go, MOVES_TO_GO_MAX) : DEFAULT_MOVES_TO_GO;
+	const uint64_t usable = clock > MOVE_OVERHEAD ? clock - MOVE_OVERHEAD : 1;
+	const uint64_t income = increment * (moves - 1);
+	const uint64_t costs = MOVE_OVERHEAD * (moves - 1);
+	const uint64_t pool = usable + income > costs ? usable + income - costs : 1;
+	// a single move left may use the whole clock, otherwise keep a reserve
+	const uint64_t reserve = moves == 1 ? usable : usable * 3 / 4;
+	maximum = std::max(uint64_t(1), std::min(pool / moves * MAXIMUM_FACTOR, reserve));
+	optimum = std::max(uint64_t(1), std::min(pool / moves, maximum));
+	offset = searched;
+	active = true;
+}
+
+/**
+ * called after each completed iteration of the main thread
+ * @param time ms since the start of the search
+ * @return true if the search should not start another iteration
+ */
+bool TimeManager::iteration_done(const move_t best, const int32_t score, const uint64_t time)
+{
+	if (iterations && MoveOrder::same_move(best, previous_best)) {
+		stability = std::min(stability + 1, STABILITY_MAX);
+	}
+	else {
+		stability = 0;
+	}
+	const int32_t drop = iterations ? std::min(std::max(previous_score - score, 0), SCORE_DROP_MAX) : 0;
+	const uint64_t duration = time - previous_time;
+	if (last_duration && duration > last_duration) {
+		growth = std::min(GROWTH_MAX, std::max(GROWTH_MIN, duration * 100 / last_duration));
+	}
+	last_duration = duration;
+	previous_time = time;
+	previous_best = best;
+	previous_score = score;
+	++iterations;
+	if (!active) {
+		return false;
+	}
+	// an unstable best move or a falling score earns more time
+	uint64_t budget = optimum * STABILITY_PERCENT[stability] / 100 * (100 + drop) / 100;
+	budget = std::min(budget, maximum);
+	if (time >= offset + budget) {
+		return true;
+	}
+	// the next iteration would be cut off by the hard limit
+	return time + duration * growth / 100 > offset + maximum;
+}
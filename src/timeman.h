@@ -0,0 +1,72 @@
+/*
+***************************************************************************
+**
+** Copyright (C) 2011 Zbigniew Sienkiewicz.
+** All rights reserved.
+**
+** Glaucus is Glinski's hexagonal chess engine.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+***************************************************************************
+*/
+#ifndef TIMEMAN_H
+#define TIMEMAN_H
+
+#include <inttypes.h>
+#include <atomic>
+#include "movegen.h"
+
+const uint64_t MOVE_OVERHEAD = 10;  // ms lost per move outside the search
+const uint32_t DEFAULT_MOVES_TO_GO = 30;
+const uint32_t MOVES_TO_GO_MAX = 50;
+const uint64_t MAXIMUM_FACTOR = 5;  // maximum budget in optimum budgets
+const uint32_t STABILITY_MAX = 7;
+const int32_t STABILITY_PERCENT[STABILITY_MAX + 1] = { 200, 150, 120, 100, 85, 70, 60, 50 };
+const int32_t SCORE_DROP_MAX = 100;
+const uint64_t GROWTH_MIN = 150;  // percent, iteration time growth
+const uint64_t GROWTH_MAX = 400;
+const uint64_t GROWTH_DEFAULT = 200;
+
+/**
+ * Splits the remaining clock among the moves to go. The search may stop
+ * after an iteration once the optimum budget, scaled by the stability of
+ * the best move and the trend of its score, is spent; the maximum budget
+ * is a hard limit no iteration is started beyond.
+ */
+class TimeManager
+{
+public:
+	static void new_search();
+	static void start(const uint64_t clock, const uint64_t increment, const uint32_t moves_to_go, const uint64_t searched);
+	static bool iteration_done(const move_t best, const int32_t score, const uint64_t time);
+	static bool is_active() { return active; }
+	static uint64_t get_optimum() { return optimum; }
+	static uint64_t get_maximum() { return maximum; }
+private:
+	TimeManager();
+	static uint64_t optimum;  // ms
+	static uint64_t maximum;  // ms
+	static uint64_t offset;   // ms of search before the budgets apply, spent pondering
+	static std::atomic<bool> active;
+	static move_t previous_best;
+	static int32_t previous_score;
+	static uint32_t stability;
+	static uint32_t iterations;
+	static uint64_t previous_time;
+	static uint64_t last_duration;
+	static uint64_t growth;
+};
+
+#endif // TIMEMAN_H
@@ -0,0 +1,247 @@
+/*
+***************************************************************************
+**
+** Copyright (C) 2011 Zbigniew Sienkiewicz.
+** All rights reserved.
+**
+** Glaucus is Glinski's hexagonal chess engine.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+***************************************************************************
+*/
+
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include "transtable.h"
+#include "largemem.h"
+#include "hexbitboard.h"
+
+tt_bucket *TransTable::table = nullptr;
+std::string TransTable::memory_report;
+uint64_t TransTable::buckets = 0;
+uint8_t TransTable::generation = 0;
+
+// data: move 0-15, score 16-31, depth 32-39, bound 40-41, age 42-47
+uint64_t TransTable::pack(const uint16_t move, const int16_t score, const uint8_t depth, const bound_type bound, const uint8_t age)
+{
+	return uint64_t(move) | (uint64_t(uint16_t(score)) << 16) | (uint64_t(depth) << 32)
+			| (uint64_t(bound) << 40) | (uint64_t(age & 0x3FU) << 42);
+}
+
+tt_data TransTable::unpack(const uint64_t data)
+{
+	tt_data result;
+	result.move = uint16_t(data);
+	result.score = int16_t(uint16_t(data >> 16));
+	result.depth = uint8_t(data >> 32);
+	result.bound = uint8_t((data >> 40) & 3U);
+	return result;
+}
+
+TransTable::TransTable()
+{
+}
+
+void TransTable::init()
+{
+	if (table) {
+		clear();
+	}
+	else {
+		resize(TT_DEFAULT_MB);
+	}
+}
+
+/**
+ * sets the table size, rounded down to a power of two number of buckets
+ * @return false if memory could not be allocated, the old table is kept
+ */
+bool TransTable::resize(const uint64_t megabytes)
+{
+	uint64_t count = 1;
+	while (count * 2 * sizeof(tt_bucket) <= (megabytes << 20)) {
+		count *= 2;
+	}
+	std::string report;
+	void *memory = LargeMemory::allocate(count * sizeof(tt_bucket), report);
+	if (!memory) {
+		return false;
+	}
+	LargeMemory::release(table, buckets * sizeof(tt_bucket));
+	table = static_cast<tt_bucket *>(memory);
+	buckets = count;
+	memory_report = report;
+	generation = 0;
+	return true;
+}
+
+void TransTable::clear()
+{
+	LargeMemory::clear(table, buckets * sizeof(tt_bucket));
+	generation = 0;
+}
+
+void TransTable::new_search()
+{
+	generation = (generation + 1) & 0x3FU;
+}
+
+bool TransTable::probe(const uint64_t key, tt_data &result)
+{
+	tt_bucket &bucket = table[key & (buckets - 1)];
+	for (uint32_t i = 0; i < TT_BUCKET_ENTRIES; ++i) {
+		uint64_t data = bucket.entry[i].data.load(std::memory_order_relaxed);
+		if ((bucket.entry[i].key_xor_data.load(std::memory_order_relaxed) ^ data) == key && data) {
+			result = unpack(data);
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * replaces the entry of the same position unless it is from this search
+ * and clearly deeper than a bound that is not exact, otherwise the one
+ * with the lowest depth, where each generation of age counts as four plies
+ */
+void TransTable::store(const uint64_t key, const uint16_t move, const int16_t score, const uint8_t depth, const bound_type bound)
+{
+	tt_bucket &bucket = table[key & (buckets - 1)];
+	tt_entry *victim = &bucket.entry[0];
+	int32_t victim_value = INT32_MAX;
+	uint16_t old_move = 0;
+	for (uint32_t i = 0; i < TT_BUCKET_ENTRIES; ++i) {
+		uint64_t data = bucket.entry[i].data.load(std::memory_order_relaxed);
+		if ((bucket.entry[i].key_xor_data.load(std::memory_order_relaxed) ^ data) == key) {
+			const tt_data old = unpack(data);
+			if (bound != BOUND_EXACT && int32_t(depth) + TT_REPLACE_MARGIN < int32_t(old.depth)
+					&& age_of(data) == generation) {
+				return;
+			}
+			victim = &bucket.entry[i];
+			old_move = old.move;
+			break;
+		}
+		int32_t value = int32_t(unpack(data).depth) - 4 * int32_t((generation - age_of(data)) & 0x3FU);
+		if (!data) {
+			value = INT32_MIN;
+		}
+		if (value < victim_value) {
+			victim = &bucket.entry[i];
+			victim_value = value;
+		}
+	}
+	uint64_t data = pack(move ? move : old_move, score, depth, bound, generation);
+	victim->key_xor_data.store(key ^ data, std::memory_order_relaxed);
+	victim->data.store(data, std::memory_order_relaxed);
+}
+
+/**
+ * @return permille of sampled entries written during the current search
+ */
+uint32_t TransTable::hashfull()
+{
+	uint64_t sample = buckets < 1000 ? buckets : 1000;
+	uint64_t used = 0;
+	for (uint64_t i = 0; i < sample; ++i) {
+		for (uint32_t j = 0; j < TT_BUCKET_ENTRIES; ++j) {
+			uint64_t data = table[i].entry[j].data.load(std::memory_order_relaxed);
+			if (data && age_of(data) == generation) {
+				used++;
+			}
+		}
+	}
+	return uint32_t(used * 1000 / (sample * TT_BUCKET_ENTRIES));
+}
+
+static void put_bytes(std::vector<char> &buffer, uint64_t value, const uint32_t bytes)
+{
+	for (uint32_t i = 0; i < bytes; ++i) {
+		buffer.push_back(char(value & 0xFFU));
+		value >>= 8;
+	}
+}
+
+static uint64_t get_bytes(const char *buffer, const uint32_t bytes)
+{
+	uint64_t value = 0;
+	for (uint32_t i = bytes; i > 0; --i) {
+		value = (value << 8) | uint8_t(buffer[i - 1]);
+	}
+	return value;
+}
+
+/**
+ * writes entries of at least min_depth to a file: "GLAUCUSH", version,
+ * Zobrist signature, record count and then 14 byte little endian records
+ */
+bool TransTable::save(const std::string file_name, const uint8_t min_depth, uint64_t &saved)
+{
+	std::vector<char> buffer;
+	buffer.insert(buffer.end(), "GLAUCUSH", "GLAUCUSH" + 8);
+	put_bytes(buffer, TT_FILE_VERSION, 4);
+	put_bytes(buffer, Hexbitboard::zobrist_signature(), 8);
+	put_bytes(buffer, 0, 8);  // record count, filled in below
+	saved = 0;
+	for (uint64_t i = 0; i < buckets; ++i) {
+		for (uint32_t j = 0; j < TT_BUCKET_ENTRIES; ++j) {
+			uint64_t data = table[i].entry[j].data.load(std::memory_order_relaxed);
+			uint64_t key = table[i].entry[j].key_xor_data.load(std::memory_order_relaxed) ^ data;
+			if (!data || unpack(data).depth < min_depth) {
+				continue;
+			}
+			put_bytes(buffer, key, 8);
+			put_bytes(buffer, data, 6);
+			saved++;
+		}
+	}
+	for (uint32_t i = 0; i < 8; ++i) {
+		buffer[20 + i] = char((saved >> (8 * i)) & 0xFFU);
+	}
+	std::ofstream file(file_name, std::ios::binary | std::ios::trunc);
+	return bool(file.write(buffer.data(), std::streamsize(buffer.size())));
+}
+
+/**
+ * reads a saved table in one go and stores its entries into the current
+ * table, which may be of a different size; entries take the current age
+ */
+bool TransTable::load(const std::string file_name, uint64_t &loaded)
+{
+	loaded = 0;
+	std::ifstream file(file_name, std::ios::binary | std::ios::ate);
+	if (!file) {
+		return false;
+	}
+	std::vector<char> buffer(static_cast<size_t>(file.tellg()));
+	file.seekg(0);
+	if (buffer.size() < 28 || !file.read(buffer.data(), std::streamsize(buffer.size()))) {
+		return false;
+	}
+	if (std::memcmp(buffer.data(), "GLAUCUSH", 8) != 0 || get_bytes(&buffer[8], 4) != TT_FILE_VERSION
+			|| get_bytes(&buffer[12], 8) != Hexbitboard::zobrist_signature()) {
+		return false;
+	}
+	uint64_t count = get_bytes(&buffer[20], 8);
+	if (buffer.size() != 28 + count * TT_FILE_RECORD) {
+		return false;
+	}
+	for (const char *record = &buffer[28]; loaded < count; record += TT_FILE_RECORD, ++loaded) {
+		tt_data entry = unpack(get_bytes(record + 8, 6));
+		store(get_bytes(record, 8), entry.move, entry.score, entry.depth, bound_type(entry.bound));
+	}
+	return true;
+}
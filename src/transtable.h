@@ -0,0 +1,97 @@
+/*
+***************************************************************************
+**
+** Copyright (C) 2011 Zbigniew Sienkiewicz.
+** All rights reserved.
+**
+** Glaucus is Glinski's hexagonal chess engine.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+***************************************************************************
+*/
+
+#ifndef TRANSTABLE_H
+#define TRANSTABLE_H
+
+#include <inttypes.h>
+#include <atomic>
+#include <string>
+#include "movegen.h"
+
+const uint64_t TT_DEFAULT_MB = 16;
+const uint32_t TT_BUCKET_ENTRIES = 4;
+const uint32_t TT_CACHE_LINE = 64;
+const uint32_t TT_FILE_VERSION = 1;
+const uint32_t TT_FILE_RECORD = 14;  // key and the low 48 bits of data
+const int32_t TT_REPLACE_MARGIN = 2;  // plies a result of the same position may be shallower and still replace
+
+enum bound_type { BOUND_NONE = 0, BOUND_UPPER = 1, BOUND_LOWER = 2, BOUND_EXACT = 3 };
+
+/**
+ * Each entry keeps key ^ data next to data. A reader that sees halves of
+ * two different writes gets a key that does not verify and treats it as
+ * a miss, so threads share the table without locks.
+ */
+struct tt_entry {
+	std::atomic<uint64_t> key_xor_data;
+	std::atomic<uint64_t> data;
+};
+
+struct alignas(TT_CACHE_LINE) tt_bucket {
+	tt_entry entry[TT_BUCKET_ENTRIES];
+};
+
+struct tt_data {
+	uint16_t move;
+	int16_t score;
+	uint8_t depth;
+	uint8_t bound;
+};
+
+class TransTable
+{
+public:
+	static void init();
+	static bool resize(const uint64_t megabytes);
+	static void clear();
+	static void new_search();
+	static bool probe(const uint64_t key, tt_data &result);
+	static void store(const uint64_t key, const uint16_t move, const int16_t score, const uint8_t depth, const bound_type bound);
+	static void prefetch(const uint64_t key)
+	{
+#if defined(__GNUC__)
+		__builtin_prefetch(&table[key & (buckets - 1)]);
+#endif
+	}
+	static uint32_t hashfull();
+	static bool save(const std::string file_name, const uint8_t min_depth, uint64_t &saved);
+	static bool load(const std::string file_name, uint64_t &loaded);
+	static uint64_t get_megabytes() { return (buckets * sizeof(tt_bucket)) >> 20; }
+	static std::string get_memory_report() { return memory_report; }
+	static uint16_t pack_move(const move_t move) { return uint16_t(move.set[PIECE_FROM] | (move.set[PIECE_TO] << 7)); }
+	static uint8_t move_from(const uint16_t move) { return move & 0x7FU; }
+	static uint8_t move_to(const uint16_t move) { return (move >> 7) & 0x7FU; }
+private:
+	TransTable();
+	static uint64_t pack(const uint16_t move, const int16_t score, const uint8_t depth, const bound_type bound, const uint8_t age);
+	static tt_data unpack(const uint64_t data);
+	static uint8_t age_of(const uint64_t data) { return (data >> 42) & 0x3FU; }
+	static tt_bucket *table;
+	static std::string memory_report;
+	static uint64_t buckets;
+	static uint8_t generation;
+};
+
+#endif // TRANSTABLE_H
@@ -0,0 +1,348 @@
+/*
+***************************************************************************
+**
+** Copyright (C) 2011 Zbigniew Sienkiewicz.
+** All rights reserved.
+**
+** Glaucus is Glinski's hexagonal chess engine.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+***************************************************************************
+*/
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include "tuner.h"
+#include "attacks.h"
+#include "hexbitboard.h"
+#include "movegen.h"
+#include "search.h"
+
+using std::cout;
+using std::endl;
+using std::string;
+
+const tune_param Tuner::params[PARAMS_NUMBER] = {
+	{ "KNIGHT_VALUE",       TERM_KNIGHT,        false,  1, KNIGHT_VALUE       },
+	{ "KNIGHT_VALUE_EG",    TERM_KNIGHT,        true,   1, KNIGHT_VALUE_EG    },
+	{ "KNIGHT_MOBILITY_MG", TERM_MOBILITY,      false,  1, KNIGHT_MOBILITY_MG },
+	{ "KNIGHT_MOBILITY_EG", TERM_MOBILITY,      true,   1, KNIGHT_MOBILITY_EG },
+	{ "KING_CENTER_MG",     TERM_KING_CENTER,   false,  1, KING_CENTER_MG     },
+	{ "KING_CENTER_EG",     TERM_KING_CENTER,   true,  -1, KING_CENTER_EG     },
+	{ "KING_DANGER_MG",     TERM_KING_DANGER,   false,  1, KING_DANGER_MG     },
+	{ "SAFE_MOBILITY_MG",   TERM_SAFE_MOBILITY, false,  1, SAFE_MOBILITY_MG   },
+	{ "SAFE_MOBILITY_EG",   TERM_SAFE_MOBILITY, true,   1, SAFE_MOBILITY_EG   }
+};
+
+std::vector<tune_sample> Tuner::samples;
+
+Tuner::Tuner()
+{
+}
+
+/**
+ * a line holds the xfen, the side to move (w or b) and the result from
+ * white's point of view: 1-0, 1/2-1/2, 0-1 or 1, 0.5, 0
+ */
+bool Tuner::parse(const string &line, tune_position &position)
+{
+	std::istringstream iss(line);
+	string side, result;
+	if (!(iss >> position.xfen >> side >> result)) {
+		return false;
+	}
+	if (side != "w" && side != "b") {
+		return false;
+	}
+	position.white = (side == "w");
+	if (result == "1-0" || result == "1") {
+		position.result = 1.0f;
+	}
+	else if (result == "1/2-1/2" || result == "0.5") {
+		position.result = 0.5f;
+	}
+	else if (result == "0-1" || result == "0") {
+		position.result = 0.0f;
+	}
+	else {
+		return false;
+	}
+	return true;
+}
+
+bool Tuner::load(const string file_name, std::vector<tune_position> &positions)
+{
+	std::ifstream file(file_name);
+	if (!file) {
+		cout << "cannot read " << file_name << endl;
+		return false;
+	}
+	string line;
+	uint64_t number = 0;
+	uint64_t skipped = 0;
+	tune_position position;
+	while (std::getline(file, line)) {
+		number++;
+		if (line.empty() || line[0] == '#') {
+			continue;
+		}
+		if (!parse(line, position)) {
+			if (skipped++ == 0) {
+				cout << "skipping malformed line " << number << ": " << line << endl;
+			}
+			continue;
+		}
+		positions.push_back(position);
+	}
+	if (skipped) {
+		cout << "skipped " << skipped << " malformed lines\n";
+	}
+	return true;
+}
+
+/**
+ * sets up the positions of one shard in the calling thread, plays out the
+ * quiescence line and keeps the terms of the quiet position at its end
+ */
+void Tuner::quiesce(const std::vector<tune_position> &positions, const uint64_t first, const uint64_t last,
+					std::vector<char> &valid)
+{
+	move_t line[MAX_PLY];
+	int32_t length;
+	eval_trace trace;
+	for (uint64_t i = first; i < last; ++i) {
+		const tune_position &position = positions[i];
+		MoveGen::white_to_move = position.white;
+		if (!Hexbitboard::setup_board(position.xfen)) {
+			valid[i] = false;
+			continue;
+		}
+		MoveGen::reset_move_stack();
+		MoveGen::reset_game_stack();
+		Attacks::init();
+		if (!Attacks::position_is_ok()) {
+			valid[i] = false;
+			continue;
+		}
+		Search::quiet_line(line, length);
+		for (int32_t j = 0; j < length; ++j) {
+			MoveGen::make_move(line[j]);
+		}
+		Eval::trace(trace);
+		tune_sample &sample = samples[i];
+		for (uint32_t term = 0; term < TERMS_NUMBER; ++term) {
+			sample.term[term] = int16_t(trace.term[term]);
+		}
+		sample.phase = uint8_t(trace.phase);
+		sample.result = position.result;
+		valid[i] = true;
+#ifndef NDEBUG
+		// the terms with the current constants must give back the evaluation
+		double linear = 0.0;
+		for (uint32_t param = 0; param < PARAMS_NUMBER; ++param) {
+			linear += params[param].value * coefficient(sample, param);
+		}
+		const int32_t score = MoveGen::white_to_move ? Eval::evaluate() : -Eval::evaluate();
+		assert(std::fabs(linear - score) < 1.0);
+#endif
+	}
+}
+
+// what the score gains per unit of the parameter
+double Tuner::coefficient(const tune_sample &sample, const uint32_t param)
+{
+	const tune_param &p = params[param];
+	const int32_t weight = p.endgame ? PHASE_MAX - sample.phase : sample.phase;
+	return double(p.sign * sample.term[p.term] * weight) / PHASE_MAX;
+}
+
+/**
+ * logistic loss of one shard: the score of a sample is turned into an
+ * expected result by sigmoid(scale * score) and compared with the label
+ */
+void Tuner::shard_loss(const double *weights, const double scale, const uint64_t first, const uint64_t last,
+					   double &sum, double *gradient)
+{
+	double coefficients[PARAMS_NUMBER];
+	sum = 0.0;
+	for (uint32_t param = 0; gradient && param < PARAMS_NUMBER; ++param) {
+		gradient[param] = 0.0;
+	}
+	for (uint64_t i = first; i < last; ++i) {
+		const tune_sample &sample = samples[i];
+		double score = 0.0;
+		for (uint32_t param = 0; param < PARAMS_NUMBER; ++param) {
+			coefficients[param] = coefficient(sample, param);
+			score += weights[param] * coefficients[param];
+		}
+		const double z = scale * score;
+		// log(1 + exp(-z)) + (1 - result) * z, kept finite for large scores
+		sum += std::max(-z, 0.0) + std::log1p(std::exp(-std::fabs(z))) + (1.0 - sample.result) * z;
+		if (gradient) {
+			const double error = (1.0 / (1.0 + std::exp(-z)) - sample.result) * scale;
+			for (uint32_t param = 0; param < PARAMS_NUMBER; ++param) {
+				gradient[param] += error * coefficients[param];
+			}
+		}
+	}
+}
+
+/**
+ * mean loss over all samples, the shards are summed in parallel; the mean
+ * gradient is stored when asked for
+ */
+double Tuner::loss(const double *weights, const double scale, const uint32_t threads, double *gradient)
+{
+	const uint64_t size = samples.size();
+	std::vector<double> sums(threads);
+	std::vector<double> gradients(threads * PARAMS_NUMBER);
+	std::vector<std::thread> workers;
+	for (uint32_t i = 0; i < threads; ++i) {
+		const uint64_t first = size * i / threads;
+		const uint64_t last = size * (i + 1) / threads;
+		workers.emplace_back(shard_loss, weights, scale, first, last, std::ref(sums[i]),
+							 gradient ? &gradients[i * PARAMS_NUMBER] : nullptr);
+	}
+	for (auto &worker : workers) {
+		worker.join();
+	}
+	double total = 0.0;
+	for (uint32_t i = 0; i < threads; ++i) {
+		total += sums[i];
+	}
+	if (gradient) {
+		for (uint32_t param = 0; param < PARAMS_NUMBER; ++param) {
+			gradient[param] = 0.0;
+			for (uint32_t i = 0; i < threads; ++i) {
+				gradient[param] += gradients[i * PARAMS_NUMBER + param];
+			}
+			gradient[param] /= size;
+		}
+	}
+	return total / size;
+}
+
+/**
+ * the scale turning centipawns into an expected result, fitted to the
+ * current weights so the tuned ones stay in centipawns; the loss is convex
+ * in it, a ternary search is enough
+ */
+double Tuner::fit_scale(const double *weights, const uint32_t threads)
+{
+	double low = 0.0001;
+	double high = 0.05;
+	for (uint32_t i = 0; i < TUNE_SCALE_STEPS; ++i) {
+		const double left = low + (high - low) / 3;
+		const double right = high - (high - low) / 3;
+		if (loss(weights, left, threads, nullptr) < loss(weights, right, threads, nullptr)) {
+			high = right;
+		}
+		else {
+			low = left;
+		}
+	}
+	return (low + high) / 2;
+}
+
+void Tuner::tune(const string file_name, const uint32_t epochs, const double rate, const uint32_t threads)
+{
+	const auto start = std::chrono::steady_clock::now();
+	auto elapsed = [&start]() {
+		return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+	};
+
+	std::vector<tune_position> positions;
+	if (!load(file_name, positions)) {
+		return;
+	}
+	if (positions.empty()) {
+		cout << "no positions in " << file_name << endl;
+		return;
+	}
+	cout << "loaded " << positions.size() << " positions (" << elapsed() << " ms)" << endl;
+
+	// every worker quiesces a shard on its own board
+	samples.assign(positions.size(), tune_sample());
+	std::vector<char> valid(positions.size(), false);
+	std::vector<std::thread> workers;
+	Search::clear_stop();
+	for (uint32_t i = 0; i < threads; ++i) {
+		const uint64_t first = positions.size() * i / threads;
+		const uint64_t last = positions.size() * (i + 1) / threads;
+		workers.emplace_back(quiesce, std::cref(positions), first, last, std::ref(valid));
+	}
+	for (auto &worker : workers) {
+		worker.join();
+	}
+	uint64_t kept = 0;
+	for (uint64_t i = 0; i < samples.size(); ++i) {
+		if (valid[i]) {
+			samples[kept++] = samples[i];
+		}
+	}
+	if (kept < samples.size()) {
+		cout << "skipped " << samples.size() - kept << " illegal positions\n";
+	}
+	samples.resize(kept);
+	positions.clear();
+	positions.shrink_to_fit();
+	if (samples.empty()) {
+		return;
+	}
+	cout << "quiesced " << samples.size() << " positions (" << elapsed() << " ms)" << endl;
+
+	double weights[PARAMS_NUMBER];
+	for (uint32_t param = 0; param < PARAMS_NUMBER; ++param) {
+		weights[param] = params[param].value;
+	}
+	const double scale = fit_scale(weights, threads);
+	cout << "scale " << scale << ", loss " << loss(weights, scale, threads, nullptr) << " (" << elapsed() << " ms)" << endl;
+
+	double gradient[PARAMS_NUMBER];
+	double first_moment[PARAMS_NUMBER] = {};
+	double second_moment[PARAMS_NUMBER] = {};
+	double beta1_power = 1.0;
+	double beta2_power = 1.0;
+	for (uint32_t epoch = 1; epoch <= epochs; ++epoch) {
+		const double current = loss(weights, scale, threads, gradient);
+		beta1_power *= ADAM_BETA1;
+		beta2_power *= ADAM_BETA2;
+		for (uint32_t param = 0; param < PARAMS_NUMBER; ++param) {
+			first_moment[param] = ADAM_BETA1 * first_moment[param] + (1.0 - ADAM_BETA1) * gradient[param];
+			second_moment[param] = ADAM_BETA2 * second_moment[param] + (1.0 - ADAM_BETA2) * gradient[param] * gradient[param];
+			const double first = first_moment[param] / (1.0 - beta1_power);
+			const double second = second_moment[param] / (1.0 - beta2_power);
+			weights[param] -= rate * first / (std::sqrt(second) + ADAM_EPSILON);
+		}
+		if (epoch % TUNE_REPORT == 0 || epoch == epochs) {
+			cout << "epoch " << epoch << " loss " << current << " (" << elapsed() << " ms)" << endl;
+		}
+	}
+
+	cout << "loss " << loss(weights, scale, threads, nullptr) << ", tuned constants for eval.h:\n";
+	for (uint32_t param = 0; param < PARAMS_NUMBER; ++param) {
+		cout << "const int32_t " << params[param].name << " = " << std::lround(weights[param])
+			 << ";  // was " << params[param].value << "\n";
+	}
+	samples.clear();
+	samples.shrink_to_fit();
+}
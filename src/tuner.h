@@ -0,0 +1,90 @@
+/*
+***************************************************************************
+**
+** Copyright (C) 2011 Zbigniew Sienkiewicz.
+** All rights reserved.
+**
+** Glaucus is Glinski's hexagonal chess engine.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+***************************************************************************
+*/
+
+#ifndef TUNER_H
+#define TUNER_H
+
+#include <inttypes.h>
+#include <string>
+#include <vector>
+#include "eval.h"
+
+const uint32_t TUNE_EPOCHS_DEFAULT = 500;
+const double TUNE_RATE_DEFAULT = 1.0;  // first Adam steps in centipawns
+const double ADAM_BETA1 = 0.9;
+const double ADAM_BETA2 = 0.999;
+const double ADAM_EPSILON = 1e-8;
+const uint32_t TUNE_REPORT = 50;  // epochs between progress lines
+const uint32_t TUNE_SCALE_STEPS = 40;
+const uint32_t PARAMS_NUMBER = 9;
+
+// a labelled position as read from the file
+struct tune_position {
+	std::string xfen;
+	bool white;    // side to move
+	float result;  // 1 white wins, 0.5 draw, 0 black wins
+};
+
+// a labelled position brought to rest, only its terms are kept
+struct tune_sample {
+	int16_t term[TERMS_NUMBER];
+	uint8_t phase;
+	float result;
+};
+
+// a constant of eval.h and the term it weights in one game phase
+struct tune_param {
+	const char *name;
+	eval_term term;
+	bool endgame;
+	int32_t sign;  // the constant enters the score with this sign
+	int32_t value;
+};
+
+/**
+ * Texel tuner: every position is quiesced once and reduced to its
+ * evaluation terms, the score is then linear in the weights, so the
+ * logistic loss and its gradient are summed over shards of the samples in
+ * parallel without evaluating positions again, and Adam takes the steps.
+ */
+class Tuner
+{
+public:
+	static void tune(const std::string file_name, const uint32_t epochs, const double rate, const uint32_t threads);
+private:
+	Tuner();
+	static bool load(const std::string file_name, std::vector<tune_position> &positions);
+	static bool parse(const std::string &line, tune_position &position);
+	static void quiesce(const std::vector<tune_position> &positions, const uint64_t first, const uint64_t last,
+						std::vector<char> &valid);
+	static double coefficient(const tune_sample &sample, const uint32_t param);
+	static double loss(const double *weights, const double scale, const uint32_t threads, double *gradient);
+	static void shard_loss(const double *weights, const double scale, const uint64_t first, const uint64_t last,
+						   double &sum, double *gradient);
+	static double fit_scale(const double *weights, const uint32_t threads);
+	static const tune_param params[PARAMS_NUMBER];
+	static std::vector<tune_sample> samples;
+};
+
+#endif // TUNER_H
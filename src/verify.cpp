@@ -0,0 +1,301 @@
+/*
+***************************************************************************
+**
+** Copyright (C) 2011 Zbigniew Sienkiewicz.
+** All rights reserved.
+**
+** Glaucus is Glinski's hexagonal chess engine.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+***************************************************************************
+*/
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include "verify.h"
+#include "hexbitboard.h"
+#include "attacks.h"
+#include "mailbox.h"
+#include "eval.h"
+#include "nnue.h"
+#include "see.h"
+
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+std::mt19937_64 Verify::random(2011);
+
+static bool same_bitboards(const bitmaps &a, const bitmaps &b)
+{
+	return a.white_pieces == b.white_pieces && a.black_pieces == b.black_pieces
+			&& a.white_king == b.white_king && a.black_king == b.black_king
+			&& a.white_knight == b.white_knight && a.black_knight == b.black_knight;
+}
+
+static uint32_t strip(move_t move)
+{
+	move.set[MOVE_TYPE] = 0;
+	return move.move;
+}
+
+static string list_moves(const vector<uint32_t> &moves)
+{
+	string list;
+	for (uint32_t m : moves) {
+		move_t move;
+		move.move = m;
+		list += " " + MoveGen::move_to_str(move);
+	}
+	return list;
+}
+
+Verify::Verify()
+{
+}
+
+/**
+ * compares the current position as seen by both generators
+ * @return false and a description in reason on the first difference
+ */
+bool Verify::compare(string &reason, const uint32_t depth)
+{
+	Mailbox::load();
+	if (!same_bitboards(Mailbox::get_bitboards(), Hexbitboard::get_bitboards())) {
+		reason = "bitboards differ from the board";
+		return false;
+	}
+	// release builds do not assert the incremental state after every move
+	if (Hexbitboard::get_key() != Hexbitboard::compute_key()) {
+		reason = "incremental key differs from the board";
+		return false;
+	}
+	if (!Eval::state_is_ok()) {
+		reason = "incremental evaluation state differs from the board";
+		return false;
+	}
+	if (!Nnue::accumulator_is_ok()) {
+		reason = "network accumulator differs from a refresh";
+		return false;
+	}
+
+	color_to_move side = MoveGen::white_to_move ? WHITE : BLACK;
+	color_to_move other = MoveGen::white_to_move ? BLACK : WHITE;
+	Attacks::generate_own_attacks();
+	Attacks::generate_opponent_attacks();
+	if (Attacks::my_attacks() != Mailbox::attacks(side)) {
+		reason = "attack maps of the side to move differ";
+		return false;
+	}
+	if (Attacks::enemy_attacks() != Mailbox::attacks(other)) {
+		reason = "attack maps of the side not to move differ";
+		return false;
+	}
+
+	// the bit-sliced counters must match the attackers counted hex by hex
+	for (color_to_move colour : { WHITE, BLACK }) {
+		const attack_counts &counts = Attacks::count_attacks(colour == WHITE);
+		uint32_t slow_counts[HEXES_NUMBER_MAX];
+		Mailbox::count_attacks(colour, slow_counts);
+		for (uint8_t pos = HEX_A1; pos < HEXES_NUMBER_MAX; ++pos) {
+			const uint32_t fast_count = Hexbitboard::is_set(counts.once, pos) + Hexbitboard::is_set(counts.twice, pos)
+										+ Hexbitboard::is_set(counts.thrice, pos);
+			if (fast_count != std::min(slow_counts[pos], 3U)) {
+				reason = "attack counts of " + string(colour == WHITE ? "white" : "black") + " differ on "
+						 + Hexbitboard::pos_to_str(pos);
+				return false;
+			}
+		}
+	}
+
+	vector<uint32_t> fast, slow;
+	uint64_t bottom = MoveGen::open_ply();
+	Attacks::generate_moves();
+	MoveGen::remove_unlegal_moves();
+	for (uint64_t i = MoveGen::get_move_bottom(); i < MoveGen::get_move_top(); ++i) {
+		fast.push_back(strip(MoveGen::get_move(i)));
+	}
+	MoveGen::close_ply(bottom);
+	move_t moves[MAILBOX_MOVES_MAX];
+	uint64_t total = Mailbox::generate_legal_moves(moves);
+	for (uint64_t i = 0; i < total; ++i) {
+		slow.push_back(strip(moves[i]));
+	}
+	std::sort(fast.begin(), fast.end());
+	std::sort(slow.begin(), slow.end());
+	if (fast != slow) {
+		vector<uint32_t> missing, extra;
+		std::set_difference(slow.begin(), slow.end(), fast.begin(), fast.end(), std::back_inserter(missing));
+		std::set_difference(fast.begin(), fast.end(), slow.begin(), slow.end(), std::back_inserter(extra));
+		reason = "legal moves differ, missing:" + list_moves(missing) + " extra:" + list_moves(extra);
+		return false;
+	}
+
+	// the threshold search must agree with the full swap list
+	const int32_t thresholds[] = { -KNIGHT_VALUE, -1, 0, 1, KNIGHT_VALUE };
+	bottom = MoveGen::open_ply();
+	Attacks::generate_moves();
+	MoveGen::remove_unlegal_moves();
+	for (uint64_t i = MoveGen::get_move_bottom(); i < MoveGen::get_move_top(); ++i) {
+		move_t move = MoveGen::get_move(i);
+		int32_t value = See::see(move);
+		for (int32_t threshold : thresholds) {
+			if (See::see_ge(move, threshold) != (value >= threshold)) {
+				std::ostringstream text;
+				text << "see " << MoveGen::move_to_str(move) << " is " << value << " but see_ge " << threshold << " disagrees";
+				reason = text.str();
+				MoveGen::close_ply(bottom);
+				return false;
+			}
+		}
+	}
+	MoveGen::close_ply(bottom);
+
+	for (uint32_t d = 1; d <= depth; ++d) {
+		uint64_t fast_nodes = MoveGen::perft(d);
+		uint64_t slow_nodes = Mailbox::perft(d);
+		if (fast_nodes != slow_nodes) {
+			std::ostringstream text;
+			text << "perft " << d << " differs: " << fast_nodes << " against reference " << slow_nodes;
+			reason = text.str();
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Verify::setup(const string xfen, const bool white)
+{
+	MoveGen::white_to_move = white;
+	if (!Hexbitboard::setup_board(xfen)) {
+		return false;
+	}
+	MoveGen::reset_move_stack();
+	MoveGen::reset_game_stack();
+	return Attacks::position_is_ok();
+}
+
+/**
+ * prints the failing position and then shrinks it by taking knights off
+ * the board for as long as the difference still reproduces
+ */
+void Verify::report(const string reason, const string xfen, const bool white, const uint32_t depth)
+{
+	cout << "mismatch: " << reason << endl;
+	cout << "position: fen " << xfen << (white ? " white" : " black") << endl;
+
+	string minimal = xfen;
+	string minimal_reason = reason;
+	bool shrunk = true;
+	while (shrunk) {
+		shrunk = false;
+		setup(minimal, white);
+		bits128 knights = Hexbitboard::get_white_knight() | Hexbitboard::get_black_knight();
+		uint8_t pos;
+		while ((pos = Hexbitboard::get_lsb_and_reset(knights))) {
+			setup(minimal, white);
+			Hexbitboard::set_piece(EMPTY, pos);
+			Hexbitboard::set_white_black();
+			string candidate = Hexbitboard::get_xfen();
+			string candidate_reason;
+			if (setup(candidate, white) && !compare(candidate_reason, depth)) {
+				minimal = candidate;
+				minimal_reason = candidate_reason;
+				shrunk = true;
+				break;
+			}
+		}
+	}
+	if (minimal != xfen) {
+		cout << "minimal:  fen " << minimal << (white ? " white" : " black") << endl;
+		cout << "          " << minimal_reason << endl;
+	}
+}
+
+/**
+ * plays random legal games from the current position and compares both
+ * generators at every ply, perft is run to the given depth
+ * @return false on the first mismatch
+ */
+bool Verify::random_games(const uint32_t games, const uint32_t plies, const uint32_t depth)
+{
+	const string start = Hexbitboard::get_xfen();
+	const bool start_white = MoveGen::white_to_move;
+	const vector<uint64_t> history = MoveGen::get_history();
+	MoveGen::reset_move_stack();
+	bool ok = true;
+	uint64_t positions = 0;
+	uint32_t game;
+
+	for (game = 0; ok && game < games; ++game) {
+		uint32_t made = 0;
+		string reason, xfen;
+		bool white = true;
+		for (uint32_t ply = 0; ply < plies; ++ply) {
+			xfen = Hexbitboard::get_xfen();
+			white = MoveGen::white_to_move;
+			positions++;
+			if (!compare(reason, depth)) {
+				ok = false;
+				break;
+			}
+
+			uint64_t bottom = MoveGen::open_ply();
+			Attacks::generate_moves();
+			uint64_t legal = MoveGen::remove_unlegal_moves();
+			if (!legal) {
+				MoveGen::close_ply(bottom);
+				break;
+			}
+			move_t move = MoveGen::get_move(MoveGen::get_move_bottom() + random() % legal);
+			MoveGen::close_ply(bottom);
+
+			move_t reference = move;
+			Mailbox::load();
+			Mailbox::make_move(reference);
+			MoveGen::make_move(move);
+			made++;
+			if (!same_bitboards(Mailbox::get_bitboards(), Hexbitboard::get_bitboards())) {
+				reason = "make_move " + MoveGen::move_to_str(move) + " differs from reference";
+				ok = false;
+				break;
+			}
+		}
+		while (made--) {
+			MoveGen::unmake_move();
+		}
+		if (Hexbitboard::get_xfen() != start || MoveGen::white_to_move != start_white) {
+			if (ok) {
+				reason = "unmake_move did not restore the starting position";
+				xfen = start;
+				white = start_white;
+				ok = false;
+			}
+		}
+		if (!ok) {
+			report(reason, xfen, white, depth);
+		}
+	}
+
+	// the keys since the last capture keep repetitions and the fifty-move count of the game
+	setup(start, start_white);
+	MoveGen::set_history(history);
+	Attacks::init();
+	cout << "verified " << positions << " positions in " << game << " games" << (ok ? ", no mismatch" : "") << endl;
+	return ok;
+}
@@ -0,0 +1,51 @@
+/*
+***************************************************************************
+**
+** Copyright (C) 2011 Zbigniew Sienkiewicz.
+** All rights reserved.
+**
+** Glaucus is Glinski's hexagonal chess engine.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+***************************************************************************
+*/
+
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include <inttypes.h>
+#include <string>
+#include <random>
+#include "movegen.h"
+
+/**
+ * Differential harness: plays random legal games and at every ply checks
+ * the bitboard generator (Attacks/MoveGen) against the reference Mailbox
+ * generator - board after make_move, attack maps, legal moves and perft -
+ * and that both static exchange evaluations agree.
+ */
+class Verify
+{
+public:
+	static bool random_games(const uint32_t games, const uint32_t plies, const uint32_t depth);
+private:
+	Verify();
+	static bool compare(std::string &reason, const uint32_t depth);
+	static void report(const std::string reason, const std::string xfen, const bool white, const uint32_t depth);
+	static bool setup(const std::string xfen, const bool white);
+	static std::mt19937_64 random;
+};
+
+#endif // VERIFY_H
@@ -0,0 +1,296 @@
+/*
+***************************************************************************
+**
+** Copyright (C) 2011 Zbigniew Sienkiewicz.
+** All rights reserved.
+**
+** Glaucus is Glinski's hexagonal chess engine.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**
+***************************************************************************
+*/
+/**
+ * Offline report on a search tree recorded by the profiling build of the
+ * engine (qmake CONFIG+=record): where the nodes go by ply, iteration and
+ * root move, how good the move ordering is, and which subtrees were
+ * blown up by late cutoffs or by reductions that failed.
+ */
+
+#include <inttypes.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../src/recorder.h"
+
+using std::cout;
+using std::endl;
+
+const uint32_t TOP_DEFAULT = 10;
+const uint32_t CUTOFF_BINS = 5;  // first, second, third, fourth and later move
+const char *KIND_NAMES[] = { "pv", "cut", "all", "quiescence", "hash", "pruned", "terminal" };
+
+// a node whose children were searched in vain
+struct waste {
+	uint32_t index;  // record of the node
+	uint64_t nodes;  // wasted in its subtree
+};
+
+static std::vector<tree_record> records;
+static std::vector<uint32_t> parents;  // index of the parent record, UINT32_MAX for a root
+static std::vector<uint64_t> sizes;    // nodes of the subtree
+
+static std::string pos_to_str(const uint8_t pos)
+{
+	if (pos < 10) {
+		return "?";
+	}
+	const uint8_t rank = (pos - 10) / 11;
+	char file = char('a' + (pos - 10) % 11);
+	if (file > 'i') {
+		file++;
+	}
+	return std::string(1, file) + std::to_string(rank + 1);
+}
+
+static std::string move_to_str(const uint16_t move)
+{
+	if (!move) {
+		return "--";
+	}
+	return pos_to_str(move & 0x7FU) + pos_to_str((move >> 7) & 0x7FU);
+}
+
+static bool read_records(const char *file_name)
+{
+	std::ifstream file(file_name, std::ios::binary);
+	record_header header;
+	if (!file.read(reinterpret_cast<char *>(&header), sizeof(header))
+			|| std::memcmp(header.magic, RECORD_MAGIC, sizeof(header.magic)) != 0) {
+		cout << "not a tree record: " << file_name << endl;
+		return false;
+	}
+	if (header.version != RECORD_VERSION || header.record_size != sizeof(tree_record)) {
+		cout << "unsupported record version " << header.version << endl;
+		return false;
+	}
+	tree_record record;
+	while (file.read(reinterpret_cast<char *>(&record), sizeof(record))) {
+		records.push_back(record);
+	}
+	cout << file_name << ": thread " << header.thread << ", " << records.size() << " nodes" << endl;
+	return true;
+}
+
+/**
+ * rebuilds the tree: the finished nodes wait on a stack until their
+ * parent, the next record one level up, takes them
+ */
+static void build_tree()
+{
+	std::vector<uint32_t> pending;
+	parents.assign(records.size(), UINT32_MAX);
+	sizes.assign(records.size(), 1);
+	for (uint32_t i = 0; i < records.size(); ++i) {
+		while (!pending.empty() && records[pending.back()].level > records[i].level) {
+			parents[pending.back()] = i;
+			sizes[i] += sizes[pending.back()];
+			pending.pop_back();
+		}
+		pending.push_back(i);
+	}
+}
+
+static std::vector<uint32_t> children_of(const uint32_t index)
+{
+	std::vector<uint32_t> children;
+	for (uint32_t i = index; i-- > 0 && records[i].level > records[index].level; ) {
+		if (parents[i] == index) {
+			children.push_back(i);
+		}
+	}
+	std::reverse(children.begin(), children.end());
+	return children;
+}
+
+static std::string path_of(uint32_t index)
+{
+	std::vector<uint16_t> moves;
+	for (; index != UINT32_MAX && records[index].level > 0; index = parents[index]) {
+		moves.push_back(records[index].move);
+	}
+	std::string text;
+	for (auto move = moves.rbegin(); move != moves.rend(); ++move) {
+		text += " " + move_to_str(*move);
+	}
+	return text.empty() ? " (root)" : text;
+}
+
+static std::string percent(const uint64_t part, const uint64_t whole)
+{
+	std::ostringstream text;
+	text << std::fixed << std::setprecision(1) << (whole ? 100.0 * double(part) / double(whole) : 0.0) << "%";
+	return text.str();
+}
+
+static void report_kinds()
+{
+	uint64_t kinds[NODE_TERMINAL + 1] = {};
+	for (const tree_record &record : records) {
+		if (record.kind <= NODE_TERMINAL) {
+			kinds[record.kind]++;
+		}
+	}
+	cout << "\nnodes by kind\n";
+	for (uint32_t kind = 0; kind <= NODE_TERMINAL; ++kind) {
+		cout << std::setw(12) << KIND_NAMES[kind] << std::setw(12) << kinds[kind]
+			 << std::setw(8) << percent(kinds[kind], records.size()) << endl;
+	}
+}
+
+// node counts and the move index of the cutoffs at every ply
+static void report_plies()
+{
+	std::vector<uint64_t> nodes, cutoffs;
+	std::vector<std::vector<uint64_t>> bins;
+	for (const tree_record &record : records) {
+		if (record.ply >= nodes.size()) {
+			nodes.resize(record.ply + 1);
+			cutoffs.resize(record.ply + 1);
+			bins.resize(record.ply + 1, std::vector<uint64_t>(CUTOFF_BINS));
+		}
+		nodes[record.ply]++;
+		if (record.cutoff != CUTOFF_NONE && record.cutoff > 0) {
+			cutoffs[record.ply]++;
+			bins[record.ply][std::min(uint32_t(record.cutoff), CUTOFF_BINS) - 1]++;
+		}
+	}
+	cout << "\nply       nodes  cutoffs  by move 1      2      3      4     5+\n";
+	for (uint32_t ply = 0; ply < nodes.size(); ++ply) {
+		cout << std::setw(3) << ply << std::setw(12) << nodes[ply] << std::setw(9) << cutoffs[ply];
+		for (uint32_t bin = 0; bin < CUTOFF_BINS; ++bin) {
+			cout << std::setw(bin ? 7 : 10) << percent(bins[ply][bin], cutoffs[ply]);
+		}
+		cout << endl;
+	}
+}
+
+// every root record ends one search of the root: an iteration or an aspiration re-search
+static void report_roots()
+{
+	cout << "\nroot searches\n";
+	uint32_t last_root = UINT32_MAX;
+	for (uint32_t i = 0; i < records.size(); ++i) {
+		const tree_record &root = records[i];
+		if (root.level) {
+			continue;
+		}
+		cout << "depth " << std::setw(2) << int(root.depth) << " window " << root.alpha << " " << root.beta
+			 << " score " << root.score << " nodes " << sizes[i] << endl;
+		last_root = i;
+	}
+	if (last_root == UINT32_MAX) {
+		return;
+	}
+	cout << "\nroot moves of the last search\n";
+	for (uint32_t child : children_of(last_root)) {
+		cout << std::setw(6) << move_to_str(records[child].move) << std::setw(12) << sizes[child]
+			 << std::setw(8) << percent(sizes[child], sizes[last_root]) << " score " << -records[child].score << endl;
+	}
+}
+
+static void print_top(const char *title, std::vector<waste> &list, const uint32_t top)
+{
+	uint64_t total = 0;
+	for (const waste &entry : list) {
+		total += entry.nodes;
+	}
+	cout << "\n" << title << ": " << list.size() << " nodes, " << total << " nodes wasted ("
+		 << percent(total, records.size()) << ")\n";
+	std::sort(list.begin(), list.end(), [](const waste &a, const waste &b) { return a.nodes > b.nodes; });
+	for (uint32_t i = 0; i < list.size() && i < top; ++i) {
+		const tree_record &record = records[list[i].index];
+		cout << std::setw(10) << list[i].nodes << " ply " << std::setw(2) << int(record.ply) << " depth "
+			 << std::setw(2) << int(record.depth);
+		if (record.cutoff != CUTOFF_NONE) {
+			cout << " cutoff by move " << int(record.cutoff);
+		}
+		cout << " path" << path_of(list[i].index) << endl;
+	}
+}
+
+/**
+ * late cutoffs: the subtrees of the moves tried before the one failing
+ * high; failed reductions: reduced searches of a move followed by a
+ * search of the same move at a greater depth
+ */
+static void report_waste(const uint32_t top)
+{
+	std::vector<waste> late, reduced;
+	for (uint32_t i = 0; i < records.size(); ++i) {
+		const tree_record &record = records[i];
+		if (record.kind == NODE_QUIESCENCE || (record.kind != NODE_CUT && record.kind != NODE_PV && record.kind != NODE_ALL)) {
+			continue;
+		}
+		const std::vector<uint32_t> children = children_of(i);
+		if (children.empty()) {
+			continue;
+		}
+		uint64_t late_nodes = 0;
+		uint64_t reduced_nodes = 0;
+		const uint16_t last_move = records[children.back()].move;
+		for (uint32_t j = 0; j < children.size(); ++j) {
+			const tree_record &child = records[children[j]];
+			if (record.kind == NODE_CUT && record.cutoff > 1 && child.move != last_move) {
+				late_nodes += sizes[children[j]];
+			}
+			if (j + 1 < children.size() && records[children[j + 1]].move == child.move
+					&& records[children[j + 1]].depth > child.depth) {
+				reduced_nodes += sizes[children[j]];
+			}
+		}
+		if (late_nodes) {
+			late.push_back({ i, late_nodes });
+		}
+		if (reduced_nodes) {
+			reduced.push_back({ i, reduced_nodes });
+		}
+	}
+	print_top("late cutoffs", late, top);
+	print_top("failed reductions", reduced, top);
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2) {
+		cout << "usage: treestat tree-N.bin [top]" << endl;
+		return 1;
+	}
+	const uint32_t top = argc > 2 ? uint32_t(std::atoi(argv[2])) : TOP_DEFAULT;
+	if (!read_records(argv[1])) {
+		return 1;
+	}
+	build_tree();
+	report_kinds();
+	report_plies();
+	report_roots();
+	report_waste(top);
+	return 0;
+}
@@ -0,0 +1,10 @@
+# offline report on tree-N.bin files of the recording build
+TEMPLATE = app
+TARGET = treestat
+CONFIG   += console c++11
+CONFIG   -= app_bundle
+INCLUDEPATH += ../src
+
+SOURCES += treestat.cpp
+
+HEADERS += ../src/recorder.h